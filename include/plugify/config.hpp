@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
 #include <set>
 #include <string>
@@ -16,5 +17,16 @@ namespace plugify {
 		std::set<std::string> repositories; ///< A collection of repository paths.
 		std::optional<Severity> logSeverity; ///< The severity level for logging.
 		std::optional<bool> preferOwnSymbols; ///< Flag indicating if the modules should prefer its own symbols over shared symbols.
+		std::optional<bool> parallelStartup; ///< Flag indicating if the plugins should be loaded and started in parallel by dependency levels.
+		std::optional<uint32_t> workerThreads; ///< Maximum number of worker threads used for parallel tasks (0 means hardware concurrency).
+		std::optional<double> updateBudget; ///< Time budget for plugin updates per tick in milliseconds (0 means unlimited).
+		std::optional<bool> hotReload; ///< Flag indicating if the plugins should be reloaded automatically when their files are changed.
+		std::optional<bool> descriptorCache; ///< Flag indicating if the parsed package descriptors should be cached on disk between runs.
+		std::optional<bool> descriptorCacheChecksum; ///< Flag indicating if the descriptor cache should also validate entries by file checksum.
+		std::optional<bool> manifestCache; ///< Flag indicating if the remote package manifests should be cached on disk and revalidated with conditional requests.
+		std::optional<double> manifestCacheTTL; ///< Time in seconds during which a cached manifest is used without contacting the server (0 means always revalidate).
+		std::optional<uint32_t> downloadRetries; ///< Number of times an interrupted package download is resumed before giving up.
+		std::optional<double> downloadRetryDelay; ///< Delay in seconds before the first retry of a package download, doubled on every next one.
+		std::optional<uint64_t> downloadSpeedLimit; ///< Maximum download speed of package archives in bytes per second (0 means unlimited).
 	};
 } // namespace plugify
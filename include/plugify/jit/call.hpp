@@ -4,8 +4,12 @@
 #include <plugify/mem_addr.hpp>
 #include <plugify/method.hpp>
 #include <string_view>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
 #include <utility>
 #include <memory>
+#include <type_traits>
 #include <vector>
 
 namespace plugify {
@@ -46,16 +50,21 @@ namespace plugify {
 		/**
 		 * @struct Parameters
 		 * @brief Structure to represent function parameters.
+		 * @details Up to kInlineCapacity arguments are stored inline, so the common case never touches the heap.
 		 */
 		struct Parameters {
 			typedef const uint64_t* Data;
-			
+
+			static constexpr size_t kInlineCapacity = 16; ///< Number of arguments stored without allocation.
+
 			/**
 			 * @brief Constructor.
-			 * @param count Parameters count.
+			 * @param count Parameters count, used to reserve the storage.
 			 */
 			explicit Parameters(size_t count) {
-				arguments.reserve(count);
+				if (count > kInlineCapacity) {
+					Grow(count);
+				}
 			}
 
 			/**
@@ -63,11 +72,19 @@ namespace plugify {
 			 * @tparam T Type of the argument.
 			 * @param val Value to set.
 			 * @noreturn
+			 * @note Arguments wider than 64 bits (vectors passed by value) take several consecutive slots,
+			 * the storage grows onto the heap when they do not fit.
 			 */
 			template<typename T>
 			void AddArgument(T val) {
-				uint64_t& arg = arguments.emplace_back(0);
-				*(T*) &arg = val;
+				constexpr size_t slots = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+				if (size + slots > capacity) {
+					Grow(std::max(capacity * 2, size + slots));
+				}
+				uint64_t* arg = (heap ? heap.get() : storage) + size;
+				std::fill_n(arg, slots, 0);
+				std::memcpy(arg, &val, sizeof(T));
+				size += slots;
 			}
 
 			/**
@@ -75,13 +92,27 @@ namespace plugify {
 			 * @return Pointer to the arguments storage.
 			 */
 			Data GetDataPtr() const noexcept {
-				return arguments.data();
+				return heap ? heap.get() : storage;
 			}
-			
+
 		private:
-			std::vector<uint64_t> arguments; ///< Raw storage for function arguments.
+			/**
+			 * @brief Move the added arguments into a heap block of the given size.
+			 * @param newCapacity Number of 64-bit slots to allocate.
+			 */
+			void Grow(size_t newCapacity) {
+				auto block = std::make_unique<uint64_t[]>(newCapacity);
+				std::copy_n(heap ? heap.get() : storage, size, block.get());
+				heap = std::move(block);
+				capacity = newCapacity;
+			}
+
+			uint64_t storage[kInlineCapacity]; ///< Inline storage for function arguments.
+			std::unique_ptr<uint64_t[]> heap; ///< Storage for arguments which do not fit inline.
+			size_t capacity{kInlineCapacity}; ///< Number of 64-bit slots available.
+			size_t size{}; ///< Number of 64-bit slots used by added arguments.
 		};
-		
+
 		struct Return {
 			/**
 			 * @brief Constructs an object of type `T` at the memory location.
@@ -132,7 +163,9 @@ namespace plugify {
 		};
 	
 		using CallingFunc = void(*)(Parameters::Data params, const Return*); // Return can be null
+		using BatchFunc = void(*)(Parameters::Data params, size_t stride, const Return*, size_t count); // Return can be null if function returns void
 		using HiddenParam = bool(*)(ValueType);
+		using ValueParam = bool(*)(ValueType);
 
 		/**
 		 * @brief Get a dynamically created function based on the raw signature. 
@@ -150,9 +183,34 @@ namespace plugify {
 		 * @param target Target function to call.
 		 * @param waitType Optionally insert a breakpoint before the call.
 		 * @param hidden If true, return will be pass as hidden argument.
+		 * @param value If true, a vector parameter which is not a reference will be passed by value, in vector registers where the ABI allows it.
 		 * @return Pointer to the generated function.
+		 * @note Without the value predicate every struct parameter is passed by pointer.
+		 */
+		MemAddr GetJitFunc(MethodHandle method, MemAddr target, WaitType waitType = WaitType::None, HiddenParam hidden = &ValueUtils::IsHiddenParam, ValueParam value = nullptr);
+
+		/**
+		 * @brief Get a dynamically created function which calls the target once per argument block.
+		 * @param sig Function signature.
+		 * @param target Target function to call.
+		 * @param hidden If true, return will be pass as hidden argument.
+		 * @return Pointer to the generated function, see BatchFunc.
+		 *
+		 * @details Argument blocks are laid out like Parameters and placed `stride` bytes apart,
+		 * the return values are written to consecutive Return objects. The loop runs in the
+		 * generated code, so the whole batch costs a single indirect call.
+		 */
+		MemAddr GetJitBatchFunc(const asmjit::FuncSignature& sig, MemAddr target, bool hidden);
+
+		/**
+		 * @brief Get a dynamically created function which calls the target once per argument block.
+		 * @param method Reference to the method.
+		 * @param target Target function to call.
+		 * @param hidden If true, return will be pass as hidden argument.
+		 * @param value If true, a vector parameter which is not a reference will be passed by value.
+		 * @return Pointer to the generated function, see BatchFunc.
 		 */
-		MemAddr GetJitFunc(MethodHandle method, MemAddr target, WaitType waitType = WaitType::None, HiddenParam hidden = &ValueUtils::IsHiddenParam);
+		MemAddr GetJitBatchFunc(MethodHandle method, MemAddr target, HiddenParam hidden = &ValueUtils::IsHiddenParam, ValueParam value = nullptr);
 
 		/**
 		 * @brief Get a dynamically created function.
@@ -161,6 +219,13 @@ namespace plugify {
 		 */
 		MemAddr GetFunction() const noexcept { return _function; }
 
+		/**
+		 * @brief Get the shared stub which the generated function jumps to.
+		 * @return Pointer to the shared stub.
+		 * @note The returned pointer is nullptr if the code is not shared.
+		 */
+		MemAddr GetStub() const noexcept { return _stub; }
+
 		/**
 		 * @brief Get the target associated with the object.
 		 * @details This function returns a pointer to the target function associated with the object.
@@ -169,6 +234,31 @@ namespace plugify {
 		 */
 		MemAddr GetTargetFunc() const noexcept { return _targetFunc; }
 
+		/**
+		 * @brief Call the target directly with the host calling convention.
+		 * @tparam Ret Return type of the target.
+		 * @tparam Args Argument types of the target.
+		 * @param args Arguments to pass.
+		 * @return Value returned by the target.
+		 *
+		 * @details When the signature is known at compile time this skips the Parameters buffer
+		 * and the generated stub, so arguments go straight to registers. Only valid when
+		 * IsInvocable() returns true and the types match the method exactly.
+		 */
+		template<typename Ret, typename... Args>
+		Ret Invoke(Args... args) const {
+			static_assert((std::is_trivially_copyable_v<Args> && ...), "Arguments must be passed as is, like the stub passes them");
+			static_assert(std::is_void_v<Ret> || std::is_trivially_copyable_v<Ret>, "Return must be passed as is, like the stub passes it");
+			assert(IsInvocable() && "Invoke requires a successful GetJitFunc() with the host calling convention and no hidden return");
+			return _targetFunc.RCast<Ret(*)(Args...)>()(args...);
+		}
+
+		/**
+		 * @brief Check if the target can be called directly through Invoke().
+		 * @return True if the function was generated for the host calling convention, without a hidden return and not as a batch.
+		 */
+		bool IsInvocable() const noexcept { return _function && _direct; }
+
 		/**
 		 * @brief Get the error message, if any.
 		 * @return Error message.
@@ -192,9 +282,14 @@ namespace plugify {
 		 */
 		JitCall& operator=(JitCall&& other) noexcept;
 
+	private:
+		MemAddr GetJitFunc(const asmjit::FuncSignature& sig, MemAddr target, WaitType waitType, bool hidden, bool batch);
+
 	private:
 		std::weak_ptr<asmjit::JitRuntime> _rt;
 		MemAddr _function;
+		MemAddr _stub; ///< Shared stub which the thunk in _function jumps to, nullptr when the code is not shared.
+		bool _direct{}; ///< Target has the host calling convention and no hidden return, so Invoke() can call it.
 		union {
 			MemAddr _targetFunc;
 			const char* _errorCode{};
@@ -1,6 +1,7 @@
 #include <asmjit/a64.h>
 #include <plugify/jit/call.hpp>
 #include <plugify/jit/helpers.hpp>
+#include <plugify/jit/stub_cache.hpp>
 #include <optional>
 
 using namespace plugify;
@@ -16,6 +17,9 @@ JitCall::~JitCall() {
 	if (_function) {
 		if (auto rt = _rt.lock()) {
 			rt->release(_function);
+			if (_stub) {
+				JitStubCache::Release(rt, _stub);
+			}
 		}
 	}
 }
@@ -23,28 +27,33 @@ JitCall::~JitCall() {
 JitCall& JitCall::operator=(JitCall&& other) noexcept {
 	_rt = std::move(other._rt);
 	_function = std::exchange(other._function, nullptr);
+	_stub = std::exchange(other._stub, nullptr);
+	_direct = std::exchange(other._direct, false);
 	_targetFunc = std::exchange(other._targetFunc, nullptr);
 	return *this;
 }
 
-MemAddr JitCall::GetJitFunc(const asmjit::FuncSignature& sig, MemAddr target, WaitType waitType, bool hidden) {
-	if (_function)
-		return _function;
-
-	auto rt = _rt.lock();
-	if (!rt) {
-		_errorCode = "JitRuntime invalid";
-		return nullptr;
-	}
+// Generates the trampoline, the target is embedded only when stubs can't be shared and is loaded from the thunk data slot otherwise
+// A batch trampoline repeats the call for every argument block, the loop lives in the generated code
+static const char* BuildCallStub(asmjit::JitRuntime& rt, const asmjit::FuncSignature& signature, JitCall::WaitType waitType, MemAddr target, bool hidden, bool batch, void*& function, size_t& size) {
+	using Parameters = JitCall::Parameters;
+	using Return = JitCall::Return;
+	using WaitType = JitCall::WaitType;
 
-	_targetFunc = target;
+	// wide arguments are split into the registers which actually carry them
+	asmjit::FuncSignature sig;
+	JitUtils::ArgLayout layout; // arguments keep their slots, nothing is split on AArch64 yet
+	if (const char* error = JitUtils::ExpandSignature(signature, sig, layout))
+		return error;
 
 	asmjit::CodeHolder code;
-	code.init(rt->environment(), rt->cpuFeatures());
+	code.init(rt.environment(), rt.cpuFeatures());
 
 	// initialize function
 	asmjit::a64::Compiler cc(&code);
-	asmjit::FuncNode* func = cc.addFunc(asmjit::FuncSignature::build<void, Parameters*, Return*>());// Create the wrapper function around call we JIT
+	asmjit::FuncNode* func = batch ?
+			cc.addFunc(asmjit::FuncSignature::build<void, Parameters::Data, size_t, Return*, size_t>()) :
+			cc.addFunc(asmjit::FuncSignature::build<void, Parameters*, Return*>());// Create the wrapper function around call we JIT
 
 	/*StringLogger log;
 	auto kFormatFlags = FormatFlags::kMachineCode | FormatFlags::kExplainImms | FormatFlags::kRegCasts | FormatFlags::kHexImms | FormatFlags::kHexOffsets | FormatFlags::kPositions;
@@ -57,11 +66,32 @@ MemAddr JitCall::GetJitFunc(const asmjit::FuncSignature& sig, MemAddr target, Wa
 	func->frame().resetPreservedFP();
 #endif
 
+	// context is read before anything else could clobber it
+	asmjit::a64::Gp targetReg = cc.newGpx("targetReg");
+	if constexpr (JitUtils::kSharedStubs) {
+		func->frame().addUnavailableRegs(asmjit::a64::x17);
+		cc.mov(targetReg, asmjit::a64::x17);
+		cc.ldr(targetReg, asmjit::a64::ptr(targetReg));
+	}
+
 	asmjit::a64::Gp paramImm = cc.newGpx();
 	func->setArg(0, paramImm);
 
 	asmjit::a64::Gp returnImm = cc.newGpx();
-	func->setArg(1, returnImm);
+	asmjit::a64::Gp strideImm = cc.newGpx();
+	asmjit::a64::Gp countImm = cc.newGpx();
+	asmjit::Label loop = cc.newLabel();
+	asmjit::Label done = cc.newLabel();
+	if (batch) {
+		func->setArg(1, strideImm);
+		func->setArg(2, returnImm);
+		func->setArg(3, countImm);
+
+		cc.cbz(countImm, done);
+		cc.bind(loop);
+	} else {
+		func->setArg(1, returnImm);
+	}
 
 	// paramMem = ((char*)paramImm) + i (char* size walk, uint64_t size r/w)
 	asmjit::a64::Gp i = cc.newGpx();
@@ -97,8 +127,7 @@ MemAddr JitCall::GetJitFunc(const asmjit::FuncSignature& sig, MemAddr target, Wa
 			cc.ldr(arg.as<asmjit::a64::Vec>(), paramMem);
 		} else {
 			// ex: void example(__m128i xmmreg) is invalid: https://github.com/asmjit/asmjit/issues/83
-			_errorCode = "Parameters wider than 64bits not supported";
-			return nullptr;
+			return "Parameters wider than 64bits not supported";
 		}
 
 		argRegisters.emplace_back(std::move(arg));
@@ -119,9 +148,13 @@ MemAddr JitCall::GetJitFunc(const asmjit::FuncSignature& sig, MemAddr target, Wa
 	}
 
 	// Gen the call
+	if constexpr (!JitUtils::kSharedStubs) {
+		cc.mov(targetReg, (uint64_t) target.GetPtr());
+	}
+
 	asmjit::InvokeNode* invokeNode;
 	cc.invoke(&invokeNode,
-			(uint64_t) target.GetPtr(),
+			targetReg,
 			sig
 	);
 
@@ -161,6 +194,17 @@ MemAddr JitCall::GetJitFunc(const asmjit::FuncSignature& sig, MemAddr target, Wa
 		}
 	}
 
+	if (batch) {
+		// next argument block and return slot
+		cc.add(paramImm, paramImm, strideImm);
+		if (sig.hasRet() || hidden) {
+			cc.add(returnImm, returnImm, sizeof(Return));
+		}
+		cc.subs(countImm, countImm, 1);
+		cc.b_ne(loop);
+		cc.bind(done);
+	}
+
 	//cc.ret();
 
 	// end of the function body
@@ -169,24 +213,88 @@ MemAddr JitCall::GetJitFunc(const asmjit::FuncSignature& sig, MemAddr target, Wa
 	// write to buffer
 	cc.finalize();
 
-	asmjit::Error err = rt->add(&_function, &code);
+	asmjit::Error err = rt.add(&function, &code);
 	if (err) {
-		_function = nullptr;
-		_errorCode = asmjit::DebugUtils::errorAsString(err);
-		return nullptr;
+		function = nullptr;
+		return asmjit::DebugUtils::errorAsString(err);
 	}
 
+	size = code.codeSize();
+
 	//PL_LOG_VERBOSE("JIT Stub:\n{}", log.data());
 
+	return nullptr;
+}
+
+MemAddr JitCall::GetJitFunc(const asmjit::FuncSignature& sig, MemAddr target, WaitType waitType, bool hidden) {
+	return GetJitFunc(sig, target, waitType, hidden, false);
+}
+
+MemAddr JitCall::GetJitBatchFunc(const asmjit::FuncSignature& sig, MemAddr target, bool hidden) {
+	return GetJitFunc(sig, target, WaitType::None, hidden, true);
+}
+
+MemAddr JitCall::GetJitFunc(const asmjit::FuncSignature& sig, MemAddr target, WaitType waitType, bool hidden, bool batch) {
+	if (_function)
+		return _function;
+
+	auto rt = _rt.lock();
+	if (!rt) {
+		_errorCode = "JitRuntime invalid";
+		return nullptr;
+	}
+
+	void* function = nullptr;
+	void* stub = nullptr;
+	const char* error;
+	if constexpr (JitUtils::kSharedStubs) {
+		auto key = JitStubCache::MakeKey(batch ? JitStubCache::Kind::BatchCall : JitStubCache::Kind::Call, sig, { static_cast<uint64_t>(waitType), hidden });
+		const uint64_t slot[] = { static_cast<uintptr_t>(target) };
+		error = JitStubCache::Bind(rt, std::move(key), slot, [&](asmjit::JitRuntime& runtime, void*& code, size_t& size) {
+			return BuildCallStub(runtime, sig, waitType, nullptr, hidden, batch, code, size);
+		}, waitType != WaitType::Wait_Keypress, stub, function);
+	} else {
+		size_t size;
+		error = BuildCallStub(*rt, sig, waitType, target, hidden, batch, function, size);
+	}
+
+	if (error) {
+		_errorCode = error;
+		return nullptr;
+	}
+
+	_function = function;
+	_stub = stub;
+	// the stub is the only way to honour another calling convention or a hidden return
+	_direct = !batch && !hidden && sig.callConvId() == JitUtils::GetCallConv({});
+	_targetFunc = target;
 	return _function;
 }
 
-MemAddr JitCall::GetJitFunc(MethodRef method, MemAddr target, WaitType waitType, HiddenParam hidden) {
+static asmjit::FuncSignature GetMethodSignature(MethodRef method, JitCall::HiddenParam hidden, JitCall::ValueParam value, bool& retHidden) {
 	ValueType retType = method.GetReturnType().GetType();
-	bool retHidden = hidden(retType);
+	retHidden = hidden(retType);
 	asmjit::FuncSignature sig(JitUtils::GetCallConv(method.GetCallingConvention()), method.GetVarIndex(), JitUtils::GetRetTypeId(retHidden ? ValueType::Void : retType));
 	for (const auto& type : method.GetParamTypes()) {
-		sig.addArg(JitUtils::GetValueTypeId(type.IsReference() ? ValueType::Pointer : type.GetType()));
+		ValueType paramType = type.GetType();
+		if (value && !type.IsReference() && ValueUtils::IsBetween(paramType, ValueType::Vector2, ValueType::Vector4) && value(paramType)) {
+			// structs are classified the same way for arguments and return values
+			sig.addArg(JitUtils::GetRetTypeId(paramType));
+		} else {
+			sig.addArg(JitUtils::GetValueTypeId(type.IsReference() ? ValueType::Pointer : paramType));
+		}
 	}
+	return sig;
+}
+
+MemAddr JitCall::GetJitFunc(MethodRef method, MemAddr target, WaitType waitType, HiddenParam hidden, ValueParam value) {
+	bool retHidden;
+	asmjit::FuncSignature sig = GetMethodSignature(method, hidden, value, retHidden);
 	return GetJitFunc(sig, target, waitType, retHidden);
 }
+
+MemAddr JitCall::GetJitBatchFunc(MethodRef method, MemAddr target, HiddenParam hidden, ValueParam value) {
+	bool retHidden;
+	asmjit::FuncSignature sig = GetMethodSignature(method, hidden, value, retHidden);
+	return GetJitBatchFunc(sig, target, retHidden);
+}
@@ -1,5 +1,6 @@
 #include <plugify/jit/call.hpp>
 #include <plugify/jit/helpers.hpp>
+#include <plugify/jit/stub_cache.hpp>
 #include <optional>
 
 using namespace plugify;
@@ -15,6 +16,9 @@ JitCall::~JitCall() {
 	if (_function) {
 		if (auto rt = _rt.lock()) {
 			rt->release(_function);
+			if (_stub) {
+				JitStubCache::Release(rt, _stub);
+			}
 		}
 	}
 }
@@ -22,28 +26,33 @@ JitCall::~JitCall() {
 JitCall& JitCall::operator=(JitCall&& other) noexcept {
 	_rt = std::move(other._rt);
 	_function = std::exchange(other._function, nullptr);
+	_stub = std::exchange(other._stub, nullptr);
+	_direct = std::exchange(other._direct, false);
 	_targetFunc = std::exchange(other._targetFunc, nullptr);
 	return *this;
 }
 
-MemAddr JitCall::GetJitFunc(const asmjit::FuncSignature& sig, MemAddr target, WaitType waitType, bool) {
-	if (_function)
-		return _function;
-
-	auto rt = _rt.lock();
-	if (!rt) {
-		_errorCode = "JitRuntime invalid";
-		return nullptr;
-	}
+// Generates the trampoline, the target is embedded only when stubs can't be shared and is loaded from the thunk data slot otherwise
+// A batch trampoline repeats the call for every argument block, the loop lives in the generated code
+static const char* BuildCallStub(asmjit::JitRuntime& rt, const asmjit::FuncSignature& signature, JitCall::WaitType waitType, MemAddr target, bool batch, void*& function, size_t& size) {
+	using Parameters = JitCall::Parameters;
+	using Return = JitCall::Return;
+	using WaitType = JitCall::WaitType;
 
-	_targetFunc = target;
+	// wide arguments are split into the registers which actually carry them
+	asmjit::FuncSignature sig;
+	JitUtils::ArgLayout layout;
+	if (const char* error = JitUtils::ExpandSignature(signature, sig, layout))
+		return error;
 
 	asmjit::CodeHolder code;
-	code.init(rt->environment(), rt->cpuFeatures());
+	code.init(rt.environment(), rt.cpuFeatures());
 
 	// initialize function
 	asmjit::x86::Compiler cc(&code);
-	asmjit::FuncNode* func = cc.addFunc(asmjit::FuncSignature::build<void, Parameters*, Return*>());// Create the wrapper function around call we JIT
+	asmjit::FuncNode* func = batch ?
+			cc.addFunc(asmjit::FuncSignature::build<void, Parameters::Data, size_t, Return*, size_t>()) :
+			cc.addFunc(asmjit::FuncSignature::build<void, Parameters*, Return*>());// Create the wrapper function around call we JIT
 
 	/*StringLogger log;
 	auto kFormatFlags = FormatFlags::kMachineCode | FormatFlags::kExplainImms | FormatFlags::kRegCasts | FormatFlags::kHexImms | FormatFlags::kHexOffsets | FormatFlags::kPositions;
@@ -56,19 +65,33 @@ MemAddr JitCall::GetJitFunc(const asmjit::FuncSignature& sig, MemAddr target, Wa
 	func->frame().resetPreservedFP();
 #endif
 
+	// context is read before anything else could clobber it
+	asmjit::x86::Gp targetReg = cc.newUIntPtr("targetReg");
+	if constexpr (JitUtils::kSharedStubs) {
+		func->frame().addUnavailableRegs(asmjit::x86::r10);
+		cc.mov(targetReg, asmjit::x86::r10);
+		cc.mov(targetReg, asmjit::x86::ptr(targetReg));
+	}
+
 	asmjit::x86::Gp paramImm = cc.newUIntPtr();
 	func->setArg(0, paramImm);
 
 	asmjit::x86::Gp returnImm = cc.newUIntPtr();
-	func->setArg(1, returnImm);
-
-	// paramMem = ((char*)paramImm) + i (char* size walk, uint64_t size r/w)
-	asmjit::x86::Gp i = cc.newUIntPtr();
-	asmjit::x86::Mem paramMem = ptr(paramImm, i);
-	paramMem.setSize(sizeof(uint64_t));
-
-	// i = 0
-	cc.mov(i, 0);
+	asmjit::x86::Gp strideImm = cc.newUIntPtr();
+	asmjit::x86::Gp countImm = cc.newUIntPtr();
+	asmjit::Label loop = cc.newLabel();
+	asmjit::Label done = cc.newLabel();
+	if (batch) {
+		func->setArg(1, strideImm);
+		func->setArg(2, returnImm);
+		func->setArg(3, countImm);
+
+		cc.test(countImm, countImm);
+		cc.jz(done);
+		cc.bind(loop);
+	} else {
+		func->setArg(1, returnImm);
+	}
 
 	std::vector<asmjit::x86::Reg> argRegisters;
 	argRegisters.reserve(sig.argCount());
@@ -76,8 +99,21 @@ MemAddr JitCall::GetJitFunc(const asmjit::FuncSignature& sig, MemAddr target, Wa
 	// map argument slots to registers, following abi. (We can have multiple register per arg slot such as high and low 32bits of a 64bit slot)
 	for (uint32_t argIdx = 0; argIdx < sig.argCount(); argIdx++) {
 		const auto& argType = sig.args()[argIdx];
+		const uint32_t slot = layout.slots[argIdx];
 
 		asmjit::x86::Reg arg;
+		if (slot == JitUtils::ArgLayout::kPadding) {
+			// only keeps a register busy, the callee never reads it
+			arg = cc.newXmm();
+			cc.xorps(arg.as<asmjit::x86::Xmm>(), arg.as<asmjit::x86::Xmm>());
+			argRegisters.emplace_back(std::move(arg));
+			continue;
+		}
+
+		// paramMem = ((char*)paramImm) + slot * sizeof(uint64_t) (uint64_t size r/w)
+		asmjit::x86::Mem paramMem = ptr(paramImm, static_cast<int32_t>(slot * sizeof(uint64_t)));
+		paramMem.setSize(sizeof(uint64_t));
+
 		if (asmjit::TypeUtils::isInt(argType)) {
 			arg = cc.newUIntPtr();
 			cc.mov(arg.as<asmjit::x86::Gp>(), paramMem);
@@ -86,14 +122,10 @@ MemAddr JitCall::GetJitFunc(const asmjit::FuncSignature& sig, MemAddr target, Wa
 			cc.movq(arg.as<asmjit::x86::Xmm>(), paramMem);
 		} else {
 			// ex: void example(__m128i xmmreg) is invalid: https://github.com/asmjit/asmjit/issues/83
-			_errorCode = "Parameters wider than 64bits not supported";
-			return nullptr;
+			return "Parameters wider than 64bits not supported";
 		}
 
 		argRegisters.emplace_back(std::move(arg));
-
-		// next structure slot (+= sizeof(uint64_t))
-		cc.add(i, sizeof(uint64_t));
 	}
 
 	// allows debuggers to trap
@@ -108,9 +140,13 @@ MemAddr JitCall::GetJitFunc(const asmjit::FuncSignature& sig, MemAddr target, Wa
 	}
 
 	// Gen the call
+	if constexpr (!JitUtils::kSharedStubs) {
+		cc.mov(targetReg, (uint64_t) target.GetPtr());
+	}
+
 	asmjit::InvokeNode* invokeNode;
 	cc.invoke(&invokeNode,
-			(uint64_t) target.GetPtr(),
+			targetReg,
 			sig
 	);
 
@@ -131,8 +167,9 @@ MemAddr JitCall::GetJitFunc(const asmjit::FuncSignature& sig, MemAddr target, Wa
 			cc.mov(ptr(returnImm, sizeof(uint64_t)), asmjit::x86::rdx);
 
 		} else if (asmjit::TypeUtils::isBetween(sig.ret(), asmjit::TypeId::kFloat32x4, asmjit::TypeId::kFloat64x2)) {
-			cc.movq(ptr(returnImm), asmjit::x86::xmm0);
-			cc.movq(ptr(returnImm, sizeof(uint64_t)), asmjit::x86::xmm1);
+			// merge both eightbytes of the struct to store it at once
+			cc.movlhps(asmjit::x86::xmm0, asmjit::x86::xmm1);
+			cc.movups(ptr(returnImm), asmjit::x86::xmm0);
 		}
 #endif
 		else {
@@ -142,6 +179,17 @@ MemAddr JitCall::GetJitFunc(const asmjit::FuncSignature& sig, MemAddr target, Wa
 		}
 	}
 
+	if (batch) {
+		// next argument block and return slot
+		cc.add(paramImm, strideImm);
+		if (sig.hasRet()) {
+			cc.add(returnImm, sizeof(Return));
+		}
+		cc.dec(countImm);
+		cc.jnz(loop);
+		cc.bind(done);
+	}
+
 	//cc.ret();
 
 	// end of the function body
@@ -150,27 +198,91 @@ MemAddr JitCall::GetJitFunc(const asmjit::FuncSignature& sig, MemAddr target, Wa
 	// write to buffer
 	cc.finalize();
 
-	asmjit::Error err = rt->add(&_function, &code);
+	asmjit::Error err = rt.add(&function, &code);
 	if (err) {
-		_function = nullptr;
-		_errorCode = asmjit::DebugUtils::errorAsString(err);
-		return nullptr;
+		function = nullptr;
+		return asmjit::DebugUtils::errorAsString(err);
 	}
 
+	size = code.codeSize();
+
 	//PL_LOG_VERBOSE("JIT Stub:\n{}", log.data());
 
+	return nullptr;
+}
+
+MemAddr JitCall::GetJitFunc(const asmjit::FuncSignature& sig, MemAddr target, WaitType waitType, bool hidden) {
+	return GetJitFunc(sig, target, waitType, hidden, false);
+}
+
+MemAddr JitCall::GetJitBatchFunc(const asmjit::FuncSignature& sig, MemAddr target, bool hidden) {
+	return GetJitFunc(sig, target, WaitType::None, hidden, true);
+}
+
+MemAddr JitCall::GetJitFunc(const asmjit::FuncSignature& sig, MemAddr target, WaitType waitType, bool hidden, bool batch) {
+	if (_function)
+		return _function;
+
+	auto rt = _rt.lock();
+	if (!rt) {
+		_errorCode = "JitRuntime invalid";
+		return nullptr;
+	}
+
+	void* function = nullptr;
+	void* stub = nullptr;
+	const char* error;
+	if constexpr (JitUtils::kSharedStubs) {
+		auto key = JitStubCache::MakeKey(batch ? JitStubCache::Kind::BatchCall : JitStubCache::Kind::Call, sig, { static_cast<uint64_t>(waitType), hidden });
+		const uint64_t slot[] = { static_cast<uintptr_t>(target) };
+		error = JitStubCache::Bind(rt, std::move(key), slot, [&](asmjit::JitRuntime& runtime, void*& code, size_t& size) {
+			return BuildCallStub(runtime, sig, waitType, nullptr, batch, code, size);
+		}, waitType != WaitType::Wait_Keypress, stub, function);
+	} else {
+		size_t size;
+		error = BuildCallStub(*rt, sig, waitType, target, batch, function, size);
+	}
+
+	if (error) {
+		_errorCode = error;
+		return nullptr;
+	}
+
+	_function = function;
+	_stub = stub;
+	// the stub is the only way to honour another calling convention or a hidden return
+	_direct = !batch && !hidden && sig.callConvId() == JitUtils::GetCallConv({});
+	_targetFunc = target;
 	return _function;
 }
 
-MemAddr JitCall::GetJitFunc(MethodHandle method, MemAddr target, WaitType waitType, HiddenParam hidden) {
+static asmjit::FuncSignature GetMethodSignature(MethodHandle method, JitCall::HiddenParam hidden, JitCall::ValueParam value, bool& retHidden) {
 	ValueType retType = method.GetReturnType().GetType();
-	bool retHidden = hidden(retType);
+	retHidden = hidden(retType);
 	asmjit::FuncSignature sig(JitUtils::GetCallConv(method.GetCallingConvention()), method.GetVarIndex(), JitUtils::GetRetTypeId(retHidden ? ValueType::Pointer : retType));
 	if (retHidden) {
 		sig.addArg(JitUtils::GetValueTypeId(retType));
 	}
 	for (const auto& type : method.GetParamTypes()) {
-		sig.addArg(JitUtils::GetValueTypeId(type.IsReference() ? ValueType::Pointer : type.GetType()));
+		ValueType paramType = type.GetType();
+		if (value && !type.IsReference() && ValueUtils::IsBetween(paramType, ValueType::Vector2, ValueType::Vector4) && value(paramType)) {
+			// structs are classified the same way for arguments and return values
+			sig.addArg(JitUtils::GetRetTypeId(paramType));
+		} else {
+			sig.addArg(JitUtils::GetValueTypeId(type.IsReference() ? ValueType::Pointer : paramType));
+		}
 	}
+	return sig;
+}
+
+MemAddr JitCall::GetJitFunc(MethodHandle method, MemAddr target, WaitType waitType, HiddenParam hidden, ValueParam value) {
+	bool retHidden;
+	asmjit::FuncSignature sig = GetMethodSignature(method, hidden, value, retHidden);
 	return GetJitFunc(sig, target, waitType, retHidden);
 }
+
+MemAddr JitCall::GetJitBatchFunc(MethodHandle method, MemAddr target, HiddenParam hidden, ValueParam value) {
+	bool retHidden;
+	asmjit::FuncSignature sig = GetMethodSignature(method, hidden, value, retHidden);
+	return GetJitBatchFunc(sig, target, retHidden);
+}
@@ -144,6 +144,7 @@ namespace plugify {
 
 		using CallbackHandler = void(*)(MethodHandle method, MemAddr data, const Parameters* params, size_t count, const Return* ret);
 		using HiddenParam = bool(*)(ValueType);
+		using ValueParam = bool(*)(ValueType);
 
 		/**
 		 * @brief Get a dynamically created callback function based on the raw signature.
@@ -162,6 +163,7 @@ namespace plugify {
 		 * @param callback Callback function.
 		 * @param data User data.
 		 * @param hidden If true, return will be pass as hidden argument.
+		 * @param value If true, a vector parameter which is not a reference will be received by value, in vector registers where the ABI allows it.
 		 * @return Pointer to the generated function.
 		 *
 		 * @details Creates a new callback object, where method is a
@@ -171,8 +173,9 @@ namespace plugify {
 		 * caller of the callback. Note that the generic handler's function
 		 * type/declaration is always the same for any callback. userdata is a
 		 * pointer to arbitrary user data to be available in the generic callback handler.
+		 * Vectors received by value take two consecutive 64-bit argument slots.
 		 */
-		MemAddr GetJitFunc(MethodHandle method, CallbackHandler callback, MemAddr data = nullptr, HiddenParam hidden = &ValueUtils::IsHiddenParam);
+		MemAddr GetJitFunc(MethodHandle method, CallbackHandler callback, MemAddr data = nullptr, HiddenParam hidden = &ValueUtils::IsHiddenParam, ValueParam value = nullptr);
 
 		/**
 		 * @brief Get a dynamically created function.
@@ -181,6 +184,13 @@ namespace plugify {
 		 */
 		MemAddr GetFunction() const noexcept { return _function; }
 
+		/**
+		 * @brief Get the shared stub which the generated function jumps to.
+		 * @return Pointer to the shared stub.
+		 * @note The returned pointer is nullptr if the code is not shared.
+		 */
+		MemAddr GetStub() const noexcept { return _stub; }
+
 		/**
 		 * @brief Get the user data associated with the object.
 		 * @details This function returns a pointer to the user data associated with the object.
@@ -215,6 +225,7 @@ namespace plugify {
 	private:
 		std::weak_ptr<asmjit::JitRuntime> _rt;
 		MemAddr _function;
+		MemAddr _stub; ///< Shared stub which the thunk in _function jumps to, nullptr when the code is not shared.
 		union {
 			MemAddr _userData;
 			const char* _errorCode{};
@@ -1,6 +1,7 @@
 #include <asmjit/a64.h>
 #include <plugify/jit/callback.hpp>
 #include <plugify/jit/helpers.hpp>
+#include <plugify/jit/stub_cache.hpp>
 
 using namespace plugify;
 
@@ -15,6 +16,9 @@ JitCallback::~JitCallback() {
 	if (_function) {
 		if (auto rt = _rt.lock()) {
 			rt->release(_function);
+			if (_stub) {
+				JitStubCache::Release(rt, _stub);
+			}
 		}
 	}
 }
@@ -22,21 +26,15 @@ JitCallback::~JitCallback() {
 JitCallback& JitCallback::operator=(JitCallback&& other) noexcept {
 	_rt = std::move(other._rt);
 	_function = std::exchange(other._function, nullptr);
+	_stub = std::exchange(other._stub, nullptr);
 	_userData = std::exchange(other._userData, nullptr);
 	return *this;
 }
 
-MemAddr JitCallback::GetJitFunc(const asmjit::FuncSignature& sig, MethodRef method, CallbackHandler callback, MemAddr data, bool hidden) {
-	if (_function) 
-		return _function;
-
-	auto rt = _rt.lock();
-	if (!rt) {
-		_errorCode = "JitRuntime invalid";
-		return nullptr;
-	}
-
-	_userData = data;
+// Generates the callback, method, data and handler are embedded only when stubs can't be shared and are loaded from the thunk data slot otherwise
+static const char* BuildCallbackStub(asmjit::JitRuntime& rt, const asmjit::FuncSignature& signature, MethodRef method, JitCallback::CallbackHandler callback, MemAddr data, bool hidden, void*& function, size_t& size) {
+	using Parameters = JitCallback::Parameters;
+	using Return = JitCallback::Return;
 
 	/*
 	  AsmJit is smart enough to track register allocations and will forward
@@ -56,8 +54,14 @@ MemAddr JitCallback::GetJitFunc(const asmjit::FuncSignature& sig, MethodRef meth
 	  physical registers may be inserted as nodes.
 	*/
 
+	// wide arguments are split into the registers which actually carry them
+	asmjit::FuncSignature sig;
+	JitUtils::ArgLayout layout; // arguments keep their slots, nothing is split on AArch64 yet
+	if (const char* error = JitUtils::ExpandSignature(signature, sig, layout))
+		return error;
+
 	asmjit::CodeHolder code;
-	code.init(rt->environment(), rt->cpuFeatures());
+	code.init(rt.environment(), rt.cpuFeatures());
 
 	// initialize function
 	asmjit::a64::Compiler cc(&code);
@@ -74,6 +78,13 @@ MemAddr JitCallback::GetJitFunc(const asmjit::FuncSignature& sig, MethodRef meth
 	func->frame().resetPreservedFP();
 #endif
 
+	// context is read before anything else could clobber it
+	asmjit::a64::Gp contextReg = cc.newGpx("contextReg");
+	if constexpr (JitUtils::kSharedStubs) {
+		func->frame().addUnavailableRegs(asmjit::a64::x17);
+		cc.mov(contextReg, asmjit::a64::x17);
+	}
+
 	// map argument slots to registers, following abi.
 	std::vector<asmjit::a64::Reg> argRegisters;
 	argRegisters.reserve(sig.argCount());
@@ -87,8 +98,7 @@ MemAddr JitCallback::GetJitFunc(const asmjit::FuncSignature& sig, MethodRef meth
 		} else if (asmjit::TypeUtils::isFloat(argType)) {
 			arg = cc.newVec(argType);
 		} else {
-			_errorCode = "Parameters wider than 64bits not supported";
-			return nullptr;
+			return "Parameters wider than 64bits not supported";
 		}
 
 		func->setArg(argIdx, arg);
@@ -124,8 +134,7 @@ MemAddr JitCallback::GetJitFunc(const asmjit::FuncSignature& sig, MethodRef meth
 		} else if (asmjit::TypeUtils::isFloat(argType)) {
 			cc.str(argRegisters.at(argIdx).as<asmjit::a64::Vec>(), argsStackIdx);
 		} else {
-			_errorCode = "Parameters wider than 64bits not supported";
-			return nullptr;
+			return "Parameters wider than 64bits not supported";
 		}
 
 		// next structure slot (+= sizeof(uint64_t))
@@ -134,11 +143,22 @@ MemAddr JitCallback::GetJitFunc(const asmjit::FuncSignature& sig, MethodRef meth
 
 	// fill reg to pass method ptr to callback
 	asmjit::a64::Gp methodPtrParam = cc.newGpx("methodPtrParam");
-	cc.mov(methodPtrParam, static_cast<uintptr_t>(method)));
 
 	// fill reg to pass data ptr to callback
 	asmjit::a64::Gp dataPtrParam = cc.newGpx("dataPtrParam");
-	cc.mov(dataPtrParam, static_cast<uintptr_t>(data));
+
+	// the handler is called through a register, so shared stubs stay position independent
+	asmjit::a64::Gp callbackPtr = cc.newGpx("callbackPtr");
+
+	if constexpr (JitUtils::kSharedStubs) {
+		cc.ldr(methodPtrParam, asmjit::a64::ptr(contextReg));
+		cc.ldr(dataPtrParam, asmjit::a64::ptr(contextReg, sizeof(uint64_t)));
+		cc.ldr(callbackPtr, asmjit::a64::ptr(contextReg, sizeof(uint64_t) * 2));
+	} else {
+		cc.mov(methodPtrParam, static_cast<uintptr_t>(method));
+		cc.mov(dataPtrParam, static_cast<uintptr_t>(data));
+		cc.mov(callbackPtr, (uint64_t) callback);
+	}
 
 	// get pointer to stack structure and pass it to the user callback
 	asmjit::a64::Gp argStruct = cc.newGpx("argStruct");
@@ -161,7 +181,7 @@ MemAddr JitCallback::GetJitFunc(const asmjit::FuncSignature& sig, MethodRef meth
 
 	asmjit::InvokeNode* invokeNode;
 	cc.invoke(&invokeNode,
-			  (uint64_t) callback,
+			  callbackPtr,
 			  asmjit::FuncSignature::build<void, void*, void*, Parameters*, size_t, Return*>()
 	);
 
@@ -181,8 +201,7 @@ MemAddr JitCallback::GetJitFunc(const asmjit::FuncSignature& sig, MethodRef meth
 		} else if (asmjit::TypeUtils::isFloat(argType)) {
 			cc.ldr(argRegisters.at(argIdx).as<asmjit::a64::Vec>(), argsStackIdx);
 		} else {
-			_errorCode = "Parameters wider than 64bits not supported";
-			return nullptr;
+			return "Parameters wider than 64bits not supported";
 		}
 
 		// next structure slot (+= sizeof(uint64_t))
@@ -254,24 +273,66 @@ MemAddr JitCallback::GetJitFunc(const asmjit::FuncSignature& sig, MethodRef meth
 	// write to buffer
 	cc.finalize();
 
-	asmjit::Error err = rt->add(&_function, &code);
+	asmjit::Error err = rt.add(&function, &code);
 	if (err) {
-		_function = nullptr;
-		_errorCode = asmjit::DebugUtils::errorAsString(err);
-		return nullptr;
+		function = nullptr;
+		return asmjit::DebugUtils::errorAsString(err);
 	}
 
+	size = code.codeSize();
+
 	//PL_LOG_VERBOSE("JIT Stub:\n{}", log.data());
 
+	return nullptr;
+}
+
+MemAddr JitCallback::GetJitFunc(const asmjit::FuncSignature& sig, MethodRef method, CallbackHandler callback, MemAddr data, bool hidden) {
+	if (_function) 
+		return _function;
+
+	auto rt = _rt.lock();
+	if (!rt) {
+		_errorCode = "JitRuntime invalid";
+		return nullptr;
+	}
+
+	void* function = nullptr;
+	void* stub = nullptr;
+	const char* error;
+	if constexpr (JitUtils::kSharedStubs) {
+		auto key = JitStubCache::MakeKey(JitStubCache::Kind::Callback, sig, { hidden });
+		const uint64_t slot[] = { static_cast<uintptr_t>(method), static_cast<uintptr_t>(data), reinterpret_cast<uint64_t>(callback) };
+		error = JitStubCache::Bind(rt, std::move(key), slot, [&](asmjit::JitRuntime& runtime, void*& code, size_t& size) {
+			return BuildCallbackStub(runtime, sig, {}, nullptr, nullptr, hidden, code, size);
+		}, true, stub, function);
+	} else {
+		size_t size;
+		error = BuildCallbackStub(*rt, sig, method, callback, data, hidden, function, size);
+	}
+
+	if (error) {
+		_errorCode = error;
+		return nullptr;
+	}
+
+	_function = function;
+	_stub = stub;
+	_userData = data;
 	return _function;
 }
 
-MemAddr JitCallback::GetJitFunc(MethodRef method, CallbackHandler callback, MemAddr data, HiddenParam hidden) {
+MemAddr JitCallback::GetJitFunc(MethodRef method, CallbackHandler callback, MemAddr data, HiddenParam hidden, ValueParam value) {
 	ValueType retType = method.GetReturnType().GetType();
 	bool retHidden = hidden(retType);
 	asmjit::FuncSignature sig(asmjit::CallConvId::kHost, method.GetVarIndex(), JitUtils::GetRetTypeId(retHidden ? ValueType::Void : retType));
 	for (const auto& type : method.GetParamTypes()) {
-		sig.addArg(JitUtils::GetValueTypeId(type.IsReference() ? ValueType::Pointer : type.GetType()));
+		ValueType paramType = type.GetType();
+		if (value && !type.IsReference() && ValueUtils::IsBetween(paramType, ValueType::Vector2, ValueType::Vector4) && value(paramType)) {
+			// structs are classified the same way for arguments and return values
+			sig.addArg(JitUtils::GetRetTypeId(paramType));
+		} else {
+			sig.addArg(JitUtils::GetValueTypeId(type.IsReference() ? ValueType::Pointer : paramType));
+		}
 	}
 	return GetJitFunc(sig, method, callback, data, retHidden);
 }
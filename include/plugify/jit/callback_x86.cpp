@@ -1,5 +1,6 @@
 #include <plugify/jit/callback.hpp>
 #include <plugify/jit/helpers.hpp>
+#include <plugify/jit/stub_cache.hpp>
 #include <optional>
 
 using namespace plugify;
@@ -15,6 +16,9 @@ JitCallback::~JitCallback() {
 	if (_function) {
 		if (auto rt = _rt.lock()) {
 			rt->release(_function);
+			if (_stub) {
+				JitStubCache::Release(rt, _stub);
+			}
 		}
 	}
 }
@@ -22,21 +26,15 @@ JitCallback::~JitCallback() {
 JitCallback& JitCallback::operator=(JitCallback&& other) noexcept {
 	_rt = std::move(other._rt);
 	_function = std::exchange(other._function, nullptr);
+	_stub = std::exchange(other._stub, nullptr);
 	_userData = std::exchange(other._userData, nullptr);
 	return *this;
 }
 
-MemAddr JitCallback::GetJitFunc(const asmjit::FuncSignature& sig, MethodHandle method, CallbackHandler callback, MemAddr data, bool hidden) {
-	if (_function) 
-		return _function;
-
-	auto rt = _rt.lock();
-	if (!rt) {
-		_errorCode = "JitRuntime invalid";
-		return nullptr;
-	}
-
-	_userData = data;
+// Generates the callback, method, data and handler are embedded only when stubs can't be shared and are loaded from the thunk data slot otherwise
+static const char* BuildCallbackStub(asmjit::JitRuntime& rt, const asmjit::FuncSignature& signature, MethodHandle method, JitCallback::CallbackHandler callback, MemAddr data, bool hidden, void*& function, size_t& size) {
+	using Parameters = JitCallback::Parameters;
+	using Return = JitCallback::Return;
 
 	/*
 	  AsmJit is smart enough to track register allocations and will forward
@@ -56,8 +54,14 @@ MemAddr JitCallback::GetJitFunc(const asmjit::FuncSignature& sig, MethodHandle m
 	  physical registers may be inserted as nodes.
 	*/
 
+	// wide arguments are split into the registers which actually carry them
+	asmjit::FuncSignature sig;
+	JitUtils::ArgLayout layout;
+	if (const char* error = JitUtils::ExpandSignature(signature, sig, layout))
+		return error;
+
 	asmjit::CodeHolder code;
-	code.init(rt->environment(), rt->cpuFeatures());
+	code.init(rt.environment(), rt.cpuFeatures());
 
 	// initialize function
 	asmjit::x86::Compiler cc(&code);
@@ -74,6 +78,13 @@ MemAddr JitCallback::GetJitFunc(const asmjit::FuncSignature& sig, MethodHandle m
 	func->frame().resetPreservedFP();
 #endif
 
+	// context is read before anything else could clobber it
+	asmjit::x86::Gp contextReg = cc.newUIntPtr("contextReg");
+	if constexpr (JitUtils::kSharedStubs) {
+		func->frame().addUnavailableRegs(asmjit::x86::r10);
+		cc.mov(contextReg, asmjit::x86::r10);
+	}
+
 	// map argument slots to registers, following abi.
 	std::vector<asmjit::x86::Reg> argRegisters;
 	argRegisters.reserve(sig.argCount());
@@ -87,8 +98,7 @@ MemAddr JitCallback::GetJitFunc(const asmjit::FuncSignature& sig, MethodHandle m
 		} else if (asmjit::TypeUtils::isFloat(argType)) {
 			arg = cc.newXmm();
 		} else {
-			_errorCode = "Parameters wider than 64bits not supported";
-			return nullptr;
+			return "Parameters wider than 64bits not supported";
 		}
 
 		func->setArg(argIdx, arg);
@@ -98,51 +108,57 @@ MemAddr JitCallback::GetJitFunc(const asmjit::FuncSignature& sig, MethodHandle m
 	const uint32_t alignment = 16;
 
 	// setup the stack structure to hold arguments for user callback
-	const auto stackSize = static_cast<uint32_t>(sizeof(uint64_t) * sig.argCount());
+	const auto stackSize = static_cast<uint32_t>(sizeof(uint64_t) * layout.count);
 	asmjit::x86::Mem argsStack = cc.newStack(stackSize, alignment);
-	asmjit::x86::Mem argsStackIdx(argsStack);
-
-	// assigns some register as index reg
-	asmjit::x86::Gp i = cc.newUIntPtr();
-
-	// stackIdx <- stack[i].
-	argsStackIdx.setIndex(i);
-
-	// r/w are sizeof(uint64_t) width now
-	argsStackIdx.setSize(sizeof(uint64_t));
 
-	// set i = 0
-	cc.mov(i, 0);
+	// stack[slot], r/w are sizeof(uint64_t) width
+	auto getArgsStackIdx = [&](uint32_t argIdx) {
+		asmjit::x86::Mem argsStackIdx(argsStack);
+		argsStackIdx.setSize(sizeof(uint64_t));
+		argsStackIdx.addOffset(static_cast<int64_t>(layout.slots[argIdx] * sizeof(uint64_t)));
+		return argsStackIdx;
+	};
 
 	//// mov from arguments registers into the stack structure
 	for (uint32_t argIdx = 0; argIdx < sig.argCount(); ++argIdx) {
 		const auto& argType = sig.args()[argIdx];
 
+		// padding only keeps a register busy and carries no value
+		if (layout.slots[argIdx] == JitUtils::ArgLayout::kPadding)
+			continue;
+
 		// have to cast back to explicit register types to gen right mov type
 		if (asmjit::TypeUtils::isInt(argType)) {
-			cc.mov(argsStackIdx, argRegisters.at(argIdx).as<asmjit::x86::Gp>());
+			cc.mov(getArgsStackIdx(argIdx), argRegisters.at(argIdx).as<asmjit::x86::Gp>());
 		} else if (asmjit::TypeUtils::isFloat(argType)) {
-			cc.movq(argsStackIdx, argRegisters.at(argIdx).as<asmjit::x86::Xmm>());
+			cc.movq(getArgsStackIdx(argIdx), argRegisters.at(argIdx).as<asmjit::x86::Xmm>());
 		} else {
-			_errorCode = "Parameters wider than 64bits not supported";
-			return nullptr;
+			return "Parameters wider than 64bits not supported";
 		}
-
-		// next structure slot (+= sizeof(uint64_t))
-		cc.add(i, sizeof(uint64_t));
 	}
 
 	// fill reg to pass method ptr to callback
 	asmjit::x86::Gp methodPtrParam = cc.newUIntPtr("methodPtrParam");
-	cc.mov(methodPtrParam, static_cast<uintptr_t>(method));
 
 	// fill reg to pass data ptr to callback
 	asmjit::x86::Gp dataPtrParam = cc.newUIntPtr("dataPtrParam");
-	cc.mov(dataPtrParam, static_cast<uintptr_t>(data));
+
+	// the handler is called through a register, so shared stubs stay position independent
+	asmjit::x86::Gp callbackPtr = cc.newUIntPtr("callbackPtr");
+
+	if constexpr (JitUtils::kSharedStubs) {
+		cc.mov(methodPtrParam, asmjit::x86::ptr(contextReg));
+		cc.mov(dataPtrParam, asmjit::x86::ptr(contextReg, sizeof(uint64_t)));
+		cc.mov(callbackPtr, asmjit::x86::ptr(contextReg, sizeof(uint64_t) * 2));
+	} else {
+		cc.mov(methodPtrParam, static_cast<uintptr_t>(method));
+		cc.mov(dataPtrParam, static_cast<uintptr_t>(data));
+		cc.mov(callbackPtr, (uint64_t) callback);
+	}
 
 	// get pointer to stack structure and pass it to the user callback
 	asmjit::x86::Gp argStruct = cc.newUIntPtr("argStruct");
-	auto argCount = static_cast<size_t>(sig.argCount());
+	auto argCount = static_cast<size_t>(layout.count);
 	if (hidden) {
 		// if hidden param, then we need to offset it
 		if (--argCount != 0) {
@@ -172,7 +188,7 @@ MemAddr JitCallback::GetJitFunc(const asmjit::FuncSignature& sig, MethodHandle m
 
 	asmjit::InvokeNode* invokeNode;
 	cc.invoke(&invokeNode,
-			  (uint64_t) callback,
+			  callbackPtr,
 			  asmjit::FuncSignature::build<void, void*, void*, Parameters*, size_t, Return*>()
 	);
 
@@ -184,20 +200,18 @@ MemAddr JitCallback::GetJitFunc(const asmjit::FuncSignature& sig, MethodHandle m
 	invokeNode->setArg(4, retStruct);
 
 	// mov from arguments stack structure into regs
-	cc.mov(i, 0); // reset idx
 	for (uint32_t argIdx = 0; argIdx < sig.argCount(); ++argIdx) {
 		const auto& argType = sig.args()[argIdx];
+		if (layout.slots[argIdx] == JitUtils::ArgLayout::kPadding)
+			continue;
+
 		if (asmjit::TypeUtils::isInt(argType)) {
-			cc.mov(argRegisters.at(argIdx).as<asmjit::x86::Gp>(), argsStackIdx);
+			cc.mov(argRegisters.at(argIdx).as<asmjit::x86::Gp>(), getArgsStackIdx(argIdx));
 		} else if (asmjit::TypeUtils::isFloat(argType)) {
-			cc.movq(argRegisters.at(argIdx).as<asmjit::x86::Xmm>(), argsStackIdx);
+			cc.movq(argRegisters.at(argIdx).as<asmjit::x86::Xmm>(), getArgsStackIdx(argIdx));
 		} else {
-			_errorCode = "Parameters wider than 64bits not supported";
-			return nullptr;
+			return "Parameters wider than 64bits not supported";
 		}
-
-		// next structure slot (+= sizeof(uint64_t))
-		cc.add(i, sizeof(uint64_t));
 	}
 
 	if (hidden) {
@@ -220,12 +234,12 @@ MemAddr JitCallback::GetJitFunc(const asmjit::FuncSignature& sig, MethodHandle m
 			cc.mov(asmjit::x86::rdx, retStackIdx1);
 			cc.ret();
 		} else if (asmjit::TypeUtils::isBetween(sig.ret(), asmjit::TypeId::kFloat32x4, asmjit::TypeId::kFloat64x2)) {
-			asmjit::x86::Mem retStackIdx1(*retStack);
-			retStackIdx1.setSize(sizeof(uint64_t));
-			retStackIdx1.addOffset(sizeof(uint64_t));
+			asmjit::x86::Mem retStackVec(*retStack);
+			retStackVec.setSize(sizeof(uint64_t) * 2);
 
-			cc.movq(asmjit::x86::xmm0, retStackIdx0);
-			cc.movq(asmjit::x86::xmm1, retStackIdx1);
+			// load the struct at once and move the upper eightbyte to the second register
+			cc.movups(asmjit::x86::xmm0, retStackVec);
+			cc.movhlps(asmjit::x86::xmm1, asmjit::x86::xmm0);
 			cc.ret();
 		}
 #endif
@@ -241,19 +255,55 @@ MemAddr JitCallback::GetJitFunc(const asmjit::FuncSignature& sig, MethodHandle m
 	// write to buffer
 	cc.finalize();
 
-	asmjit::Error err = rt->add(&_function, &code);
+	asmjit::Error err = rt.add(&function, &code);
 	if (err) {
-		_function = nullptr;
-		_errorCode = asmjit::DebugUtils::errorAsString(err);
-		return nullptr;
+		function = nullptr;
+		return asmjit::DebugUtils::errorAsString(err);
 	}
 
+	size = code.codeSize();
+
 	//PL_LOG_VERBOSE("JIT Stub:\n{}", log.data());
 
+	return nullptr;
+}
+
+MemAddr JitCallback::GetJitFunc(const asmjit::FuncSignature& sig, MethodHandle method, CallbackHandler callback, MemAddr data, bool hidden) {
+	if (_function) 
+		return _function;
+
+	auto rt = _rt.lock();
+	if (!rt) {
+		_errorCode = "JitRuntime invalid";
+		return nullptr;
+	}
+
+	void* function = nullptr;
+	void* stub = nullptr;
+	const char* error;
+	if constexpr (JitUtils::kSharedStubs) {
+		auto key = JitStubCache::MakeKey(JitStubCache::Kind::Callback, sig, { hidden });
+		const uint64_t slot[] = { static_cast<uintptr_t>(method), static_cast<uintptr_t>(data), reinterpret_cast<uint64_t>(callback) };
+		error = JitStubCache::Bind(rt, std::move(key), slot, [&](asmjit::JitRuntime& runtime, void*& code, size_t& size) {
+			return BuildCallbackStub(runtime, sig, {}, nullptr, nullptr, hidden, code, size);
+		}, true, stub, function);
+	} else {
+		size_t size;
+		error = BuildCallbackStub(*rt, sig, method, callback, data, hidden, function, size);
+	}
+
+	if (error) {
+		_errorCode = error;
+		return nullptr;
+	}
+
+	_function = function;
+	_stub = stub;
+	_userData = data;
 	return _function;
 }
 
-MemAddr JitCallback::GetJitFunc(MethodHandle method, CallbackHandler callback, MemAddr data, HiddenParam hidden) {
+MemAddr JitCallback::GetJitFunc(MethodHandle method, CallbackHandler callback, MemAddr data, HiddenParam hidden, ValueParam value) {
 	ValueType retType = method.GetReturnType().GetType();
 	bool retHidden = hidden(retType);
 	asmjit::FuncSignature sig(JitUtils::GetCallConv(method.GetCallingConvention()), method.GetVarIndex(), JitUtils::GetRetTypeId(retHidden ? ValueType::Pointer : retType));
@@ -261,7 +311,13 @@ MemAddr JitCallback::GetJitFunc(MethodHandle method, CallbackHandler callback, M
 		sig.addArg(JitUtils::GetValueTypeId(retType));
 	}
 	for (const auto& type : method.GetParamTypes()) {
-		sig.addArg(JitUtils::GetValueTypeId(type.IsReference() ? ValueType::Pointer : type.GetType()));
+		ValueType paramType = type.GetType();
+		if (value && !type.IsReference() && ValueUtils::IsBetween(paramType, ValueType::Vector2, ValueType::Vector4) && value(paramType)) {
+			// structs are classified the same way for arguments and return values
+			sig.addArg(JitUtils::GetRetTypeId(paramType));
+		} else {
+			sig.addArg(JitUtils::GetValueTypeId(type.IsReference() ? ValueType::Pointer : paramType));
+		}
 	}
 	return GetJitFunc(sig, method, callback, data, retHidden);
 }
@@ -2,6 +2,7 @@
 
 #include <asmjit/asmjit.h>
 #include <plugify/method.hpp>
+#include <span>
 
 /**
  * @brief Namespace containing utility functions of jit related things.
@@ -17,5 +18,53 @@ namespace plugify::JitUtils {
 	asmjit::TypeId GetRetTypeId(ValueType valueType) noexcept;
 
 	asmjit::CallConvId GetCallConv([[maybe_unused]] std::string_view conv) noexcept;
+
+	/**
+	 * @struct ArgLayout
+	 * @brief Maps arguments of the emitted signature to the 64-bit slots of the parameter block.
+	 * @details Arguments are not always emitted in slot order, the ABI can pass a later argument
+	 * in a register which an earlier one could not use.
+	 */
+	struct ArgLayout {
+		static constexpr uint32_t kPadding = UINT32_MAX; ///< Argument which only occupies a register and carries no value.
+
+		uint32_t slots[asmjit::Globals::kMaxFuncArgs]{}; ///< Slot of every emitted argument, or kPadding.
+		uint32_t count{}; ///< Number of slots used by the arguments.
+	};
+
+	/**
+	 * @brief Build the signature which is actually emitted, arguments wider than 64 bits are split the way the ABI passes aggregates.
+	 * @param sig Function signature.
+	 * @param native Receives the signature with 64-bit arguments only.
+	 * @param layout Receives the slot of every argument in native.
+	 * @return Error message, or nullptr on success.
+	 */
+	const char* ExpandSignature(const asmjit::FuncSignature& sig, asmjit::FuncSignature& native, ArgLayout& layout) noexcept;
+
+	/**
+	 * @brief True when stubs can receive per-instance data through a scratch register.
+	 * @details r10 on x86-64 and x17 on AArch64 are never used for arguments. 32-bit x86 has
+	 * no such register for every calling convention, so stubs embed the data there instead.
+	 */
+	constexpr bool kSharedStubs = PLUGIFY_ARCH_BITS == 64;
+
+	/**
+	 * @brief Emit a thunk which loads the address of its data slot into the context register and jumps to the stub.
+	 * @param rt Runtime which will own the thunk.
+	 * @param stub Shared stub to jump to.
+	 * @param slot Values to store in the thunk data slot.
+	 * @param thunk Receives the pointer to the thunk.
+	 * @return Error code.
+	 */
+	asmjit::Error CreateThunk(asmjit::JitRuntime& rt, void* stub, std::span<const uint64_t> slot, void*& thunk) noexcept;
+
+	/**
+	 * @brief Copy position independent machine code into executable memory.
+	 * @param rt Runtime which will own the code.
+	 * @param image Machine code of the stub.
+	 * @param function Receives the pointer to the code.
+	 * @return Error code.
+	 */
+	asmjit::Error LoadStub(asmjit::JitRuntime& rt, std::span<const uint8_t> image, void*& function) noexcept;
 } // namespace plugify::JitUtils
 
@@ -1,3 +1,4 @@
+#include <asmjit/a64.h>
 #include "helpers.hpp"
 
 namespace plugify::JitUtils {
@@ -148,4 +149,51 @@ namespace plugify::JitUtils {
 #endif // PLUGIFY_ARCH_BITS
 	}
 
+	const char* ExpandSignature(const asmjit::FuncSignature& sig, asmjit::FuncSignature& native, ArgLayout& layout) noexcept {
+		// AAPCS64 passes vector structs as HFA, one member per register, which the slot layout can't express yet
+		layout = {};
+		for (uint32_t argIdx = 0; argIdx < sig.argCount(); ++argIdx) {
+			const auto& argType = sig.args()[argIdx];
+			if (!asmjit::TypeUtils::isInt(argType) && !asmjit::TypeUtils::isFloat(argType))
+				return "Parameters wider than 64bits not supported";
+			layout.slots[argIdx] = layout.count++;
+		}
+		native = sig;
+		return nullptr;
+	}
+
+	asmjit::Error CreateThunk(asmjit::JitRuntime& rt, void* stub, std::span<const uint64_t> slot, void*& thunk) noexcept {
+		asmjit::CodeHolder code;
+		code.init(rt.environment(), rt.cpuFeatures());
+
+		asmjit::a64::Assembler a(&code);
+		asmjit::Label target = a.newLabel();
+		asmjit::Label data = a.newLabel();
+
+		// x17 (IP1) is an intra-procedure-call scratch register, no calling convention passes arguments in it
+		a.adr(asmjit::a64::x17, data);
+		a.ldr(asmjit::a64::x16, asmjit::a64::ptr(target));
+		a.br(asmjit::a64::x16);
+
+		a.align(asmjit::AlignMode::kData, sizeof(uint64_t));
+		a.bind(target);
+		a.embedUInt64(reinterpret_cast<uint64_t>(stub));
+		a.bind(data);
+		for (uint64_t value : slot) {
+			a.embedUInt64(value);
+		}
+
+		return rt.add(&thunk, &code);
+	}
+
+	asmjit::Error LoadStub(asmjit::JitRuntime& rt, std::span<const uint8_t> image, void*& function) noexcept {
+		asmjit::CodeHolder code;
+		code.init(rt.environment(), rt.cpuFeatures());
+
+		asmjit::a64::Assembler a(&code);
+		a.embed(image.data(), image.size());
+
+		return rt.add(&function, &code);
+	}
+
 } // namespace plugify
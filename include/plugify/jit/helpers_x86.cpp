@@ -168,4 +168,99 @@ namespace plugify::JitUtils {
 #endif // PLUGIFY_ARCH_BITS
 	}
 
+	const char* ExpandSignature(const asmjit::FuncSignature& sig, asmjit::FuncSignature& native, ArgLayout& layout) noexcept {
+		native = asmjit::FuncSignature(sig.callConvId(), sig.vaIndex(), sig.ret());
+		layout = {};
+
+		auto addArg = [&](asmjit::TypeId type, uint32_t slot) {
+			layout.slots[native.argCount()] = slot;
+			native.addArg(type);
+		};
+
+		uint32_t vecRegs = 0;
+		uint32_t vaIndex = sig.vaIndex();
+		uint32_t hoisted = sig.argCount(); // float which was already passed ahead of its turn
+		for (uint32_t argIdx = 0; argIdx < sig.argCount(); ++argIdx) {
+			const auto& argType = sig.args()[argIdx];
+			if (argIdx == hoisted) {
+				++layout.count;
+			} else if (asmjit::TypeUtils::isInt(argType)) {
+				addArg(argType, layout.count++);
+			} else if (asmjit::TypeUtils::isFloat(argType)) {
+				addArg(argType, layout.count++);
+				++vecRegs;
+			}
+#if PLUGIFY_ARCH_BITS == 64 && !PLUGIFY_PLATFORM_WINDOWS
+			else if (asmjit::TypeUtils::isVec128(argType)) {
+				// System V passes a 16 byte aggregate of floats as two SSE eightbytes, both in registers or both on the stack
+				constexpr uint32_t kVecArgRegs = 8; // xmm0-xmm7
+				if (vecRegs == kVecArgRegs - 1) {
+					if (sig.hasVarArgs())
+						return "Vector parameter would be split between register and stack";
+
+					// Both eightbytes go to the stack, while xmm7 is still taken by the next float argument.
+					// That argument is emitted first, or a padding one if there is none, so the vector can't land in xmm7.
+					uint32_t slot = layout.count + 2;
+					uint32_t nextIdx = argIdx + 1;
+					for (; nextIdx < sig.argCount() && !asmjit::TypeUtils::isFloat(sig.args()[nextIdx]); ++nextIdx) {
+						slot += asmjit::TypeUtils::isVec128(sig.args()[nextIdx]) ? 2 : 1;
+					}
+					if (nextIdx < sig.argCount()) {
+						addArg(sig.args()[nextIdx], slot);
+						hoisted = nextIdx;
+					} else {
+						addArg(asmjit::TypeId::kFloat64, ArgLayout::kPadding);
+					}
+					vecRegs = kVecArgRegs;
+				}
+				addArg(asmjit::TypeId::kFloat64, layout.count++);
+				addArg(asmjit::TypeId::kFloat64, layout.count++);
+				vecRegs += 2;
+				if (argIdx < sig.vaIndex()) {
+					++vaIndex;
+				}
+			}
+#endif
+			else {
+				// ex: void example(__m256 ymmreg) is invalid: https://github.com/asmjit/asmjit/issues/83
+				return "Parameters wider than 64bits not supported";
+			}
+		}
+
+		if (sig.hasVarArgs()) {
+			native.setVaIndex(vaIndex);
+		}
+		return nullptr;
+	}
+
+	asmjit::Error CreateThunk(asmjit::JitRuntime& rt, void* stub, std::span<const uint64_t> slot, void*& thunk) noexcept {
+		asmjit::CodeHolder code;
+		code.init(rt.environment(), rt.cpuFeatures());
+
+		asmjit::x86::Assembler a(&code);
+		asmjit::Label data = a.newLabel();
+
+		// r10 is the static chain register, no calling convention passes arguments in it
+		a.lea(asmjit::x86::r10, asmjit::x86::ptr(data));
+		a.jmp(asmjit::Imm(reinterpret_cast<uint64_t>(stub)));
+
+		a.align(asmjit::AlignMode::kData, sizeof(uint64_t));
+		a.bind(data);
+		for (uint64_t value : slot) {
+			a.embedUInt64(value);
+		}
+
+		return rt.add(&thunk, &code);
+	}
+
+	asmjit::Error LoadStub(asmjit::JitRuntime& rt, std::span<const uint8_t> image, void*& function) noexcept {
+		asmjit::CodeHolder code;
+		code.init(rt.environment(), rt.cpuFeatures());
+
+		asmjit::x86::Assembler a(&code);
+		a.embed(image.data(), image.size());
+
+		return rt.add(&function, &code);
+	}
+
 } // namespace plugify
@@ -0,0 +1,279 @@
+#include <plugify/jit/stub_cache.hpp>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+using namespace plugify;
+
+namespace {
+	struct SharedStub {
+		void* function{};
+		size_t refCount{};
+	};
+
+	struct StubImage {
+		std::vector<uint8_t> code;
+		std::chrono::nanoseconds compileTime{};
+	};
+
+	// Anything larger can only come from a corrupted file
+	constexpr uint32_t kMaxStubCount = 1 << 16;
+	constexpr uint32_t kMaxKeySize = 1 << 12;
+	constexpr uint32_t kMaxCodeSize = 1 << 16;
+	constexpr uint32_t kMaxVersionSize = 64;
+
+	struct RuntimeStubs {
+		std::unordered_map<std::string, SharedStub> stubs;
+		std::unordered_map<void*, std::string> keys;
+		// Machine code of every persistent stub seen by the runtime, live or not
+		std::unordered_map<std::string, StubImage> images;
+		JitStubCache::Stats stats;
+	};
+
+	struct StubRegistry {
+		std::mutex mutex;
+		// weak_ptr keeps the control block alive, so a new runtime can't alias a dead one
+		std::map<std::weak_ptr<asmjit::JitRuntime>, RuntimeStubs, std::owner_less<>> runtimes;
+	};
+
+	StubRegistry& GetRegistry() {
+		static StubRegistry registry;
+		return registry;
+	}
+
+	std::string GetPlugifyVersion() {
+		return std::to_string(PLUGIFY_VERSION_MAJOR) + "." + std::to_string(PLUGIFY_VERSION_MINOR) + "." + std::to_string(PLUGIFY_VERSION_PATCH);
+	}
+
+	// FNV-1a, continues from the given hash
+	uint64_t HashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ULL) {
+		for (size_t i = 0; i < size; ++i) {
+			hash ^= static_cast<const uint8_t*>(data)[i];
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+
+	// Code generated for one CPU could use instructions which another one lacks
+	uint64_t GetTargetHash(const asmjit::JitRuntime& rt) {
+		uint64_t hash = HashBytes(&rt.environment(), sizeof(asmjit::Environment));
+		return HashBytes(&rt.cpuFeatures(), sizeof(asmjit::CpuFeatures), hash);
+	}
+
+	// Covers the key too, so an image is never restored under another signature
+	uint64_t GetImageHash(std::string_view key, const StubImage& image) {
+		uint64_t hash = HashBytes(key.data(), key.size());
+		return HashBytes(image.code.data(), image.code.size(), hash);
+	}
+
+	template<typename T>
+	void WriteValue(std::ofstream& os, const T& value) {
+		os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	void WriteBytes(std::ofstream& os, std::string_view bytes) {
+		WriteValue(os, static_cast<uint32_t>(bytes.size()));
+		os.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+	}
+
+	template<typename T>
+	bool ReadValue(std::ifstream& is, T& value) {
+		return static_cast<bool>(is.read(reinterpret_cast<char*>(&value), sizeof(T)));
+	}
+
+	template<typename Container>
+	bool ReadBytes(std::ifstream& is, Container& bytes, uint32_t maxSize) {
+		uint32_t size;
+		if (!ReadValue(is, size) || size > maxSize)
+			return false;
+		bytes.resize(size);
+		return static_cast<bool>(is.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(size)));
+	}
+}
+
+std::string JitStubCache::MakeKey(Kind kind, const asmjit::FuncSignature& sig, std::initializer_list<uint64_t> extra) {
+	std::string key;
+	key.reserve(8 + sig.argCount() + extra.size() * sizeof(uint64_t));
+	key.push_back(static_cast<char>(kind));
+	key.push_back(static_cast<char>(sig.callConvId()));
+	key.push_back(static_cast<char>(sig.vaIndex()));
+	key.push_back(static_cast<char>(sig.ret()));
+	key.push_back(static_cast<char>(sig.argCount()));
+	for (uint32_t i = 0; i < sig.argCount(); ++i) {
+		key.push_back(static_cast<char>(sig.args()[i]));
+	}
+	for (uint64_t value : extra) {
+		key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+	return key;
+}
+
+void* JitStubCache::Acquire(const std::shared_ptr<asmjit::JitRuntime>& rt, const std::string& key) {
+	auto& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	auto it = registry.runtimes.find(rt);
+	if (it == registry.runtimes.end())
+		return nullptr;
+
+	auto& runtime = it->second;
+	auto stubIt = runtime.stubs.find(key);
+	if (stubIt != runtime.stubs.end()) {
+		++stubIt->second.refCount;
+		return stubIt->second.function;
+	}
+
+	auto imageIt = runtime.images.find(key);
+	if (imageIt == runtime.images.end())
+		return nullptr;
+
+	// Copying the saved code into executable memory is all it takes, the stub has nothing to relocate
+	const auto& image = imageIt->second;
+	void* function;
+	if (JitUtils::LoadStub(*rt, image.code, function))
+		return nullptr;
+
+	runtime.stubs.emplace(key, SharedStub{ function, 1 });
+	runtime.keys.emplace(function, key);
+	++runtime.stats.loaded;
+	runtime.stats.savedTime += image.compileTime;
+	return function;
+}
+
+void* JitStubCache::Insert(const std::shared_ptr<asmjit::JitRuntime>& rt, std::string key, void* function, size_t size, std::chrono::nanoseconds compileTime) {
+	auto& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	// Runtimes which are gone took their code with them
+	std::erase_if(registry.runtimes, [](const auto& entry) { return entry.first.expired(); });
+
+	auto& runtime = registry.runtimes[rt];
+	++runtime.stats.compiled;
+	runtime.stats.compileTime += compileTime;
+
+	auto [it, inserted] = runtime.stubs.try_emplace(key, SharedStub{ function, 0 });
+	if (inserted) {
+		if (size != 0) {
+			const auto* code = static_cast<const uint8_t*>(function);
+			runtime.images.insert_or_assign(key, StubImage{ { code, code + size }, compileTime });
+		}
+		runtime.keys.emplace(function, std::move(key));
+	} else {
+		rt->release(function);
+	}
+
+	++it->second.refCount;
+	return it->second.function;
+}
+
+void JitStubCache::Release(const std::shared_ptr<asmjit::JitRuntime>& rt, void* function) {
+	auto& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	auto it = registry.runtimes.find(rt);
+	if (it == registry.runtimes.end())
+		return;
+
+	auto& runtime = it->second;
+	auto keyIt = runtime.keys.find(function);
+	if (keyIt == runtime.keys.end())
+		return;
+
+	auto stubIt = runtime.stubs.find(keyIt->second);
+	if (--stubIt->second.refCount != 0)
+		return;
+
+	rt->release(function);
+	runtime.stubs.erase(stubIt);
+	runtime.keys.erase(keyIt);
+}
+
+bool JitStubCache::Load(const std::shared_ptr<asmjit::JitRuntime>& rt, const std::filesystem::path& path) {
+	std::ifstream is(path, std::ios::binary);
+	if (!is)
+		return false;
+
+	int32_t fileVersion;
+	std::string plugifyVersion;
+	uint32_t asmjitVersion;
+	uint64_t targetHash;
+	uint32_t count;
+	if (!ReadValue(is, fileVersion) || fileVersion != kFileVersion)
+		return false;
+	if (!ReadBytes(is, plugifyVersion, kMaxVersionSize) || !ReadValue(is, asmjitVersion) || !ReadValue(is, targetHash) || !ReadValue(is, count))
+		return false;
+
+	// Never trust code produced by another build, another code generator or for another CPU
+	if (plugifyVersion != GetPlugifyVersion() || asmjitVersion != ASMJIT_LIBRARY_VERSION || targetHash != GetTargetHash(*rt) || count > kMaxStubCount)
+		return false;
+
+	std::unordered_map<std::string, StubImage> images;
+	images.reserve(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		std::string key;
+		StubImage image;
+		int64_t compileTime;
+		uint64_t imageHash;
+		if (!ReadBytes(is, key, kMaxKeySize) || !ReadValue(is, compileTime) || !ReadBytes(is, image.code, kMaxCodeSize) || !ReadValue(is, imageHash))
+			return false;
+		// One damaged image makes the whole file suspicious
+		if (image.code.empty() || imageHash != GetImageHash(key, image))
+			return false;
+		image.compileTime = std::chrono::nanoseconds(compileTime);
+		images.emplace(std::move(key), std::move(image));
+	}
+
+	auto& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	auto& runtime = registry.runtimes[rt];
+	// Images produced in this run are fresher than the saved ones
+	runtime.images.merge(images);
+	return true;
+}
+
+bool JitStubCache::Save(const std::shared_ptr<asmjit::JitRuntime>& rt, const std::filesystem::path& path) {
+	std::unordered_map<std::string, StubImage> images;
+	{
+		auto& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+
+		auto it = registry.runtimes.find(rt);
+		if (it != registry.runtimes.end()) {
+			images = it->second.images;
+		}
+	}
+
+	std::ofstream os(path, std::ios::binary | std::ios::trunc);
+	if (!os)
+		return false;
+
+	WriteValue(os, kFileVersion);
+	WriteBytes(os, GetPlugifyVersion());
+	WriteValue(os, static_cast<uint32_t>(ASMJIT_LIBRARY_VERSION));
+	WriteValue(os, GetTargetHash(*rt));
+	WriteValue(os, static_cast<uint32_t>(images.size()));
+	for (const auto& [key, image] : images) {
+		WriteBytes(os, key);
+		WriteValue(os, static_cast<int64_t>(image.compileTime.count()));
+		WriteBytes(os, { reinterpret_cast<const char*>(image.code.data()), image.code.size() });
+		WriteValue(os, GetImageHash(key, image));
+	}
+
+	return static_cast<bool>(os.flush());
+}
+
+JitStubCache::Stats JitStubCache::GetStats(const std::shared_ptr<asmjit::JitRuntime>& rt) {
+	auto& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	auto it = registry.runtimes.find(rt);
+	if (it == registry.runtimes.end())
+		return {};
+
+	auto stats = it->second.stats;
+	stats.shared = it->second.stubs.size();
+	return stats;
+}
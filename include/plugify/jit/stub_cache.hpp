@@ -0,0 +1,161 @@
+#pragma once
+
+#include <asmjit/asmjit.h>
+#include <plugify/jit/helpers.hpp>
+#include <chrono>
+#include <filesystem>
+#include <initializer_list>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace plugify {
+	/**
+	 * @class JitStubCache
+	 * @brief Interns generated trampolines by signature.
+	 *
+	 * @details Stubs which only differ by the target or user data are compiled once per
+	 * asmjit::JitRuntime and shared between JitCall and JitCallback instances. Each instance
+	 * gets a tiny thunk which points the context register to its own data slot and jumps
+	 * into the shared stub. Shared stubs are reference counted and released back to the
+	 * runtime together with the last thunk which uses them.
+	 *
+	 * Shared stubs don't embed any absolute address, so their machine code can be saved to
+	 * disk and copied back into executable memory on the next start instead of compiling it again.
+	 *
+	 * Plugify itself never creates a runtime, so the cache lifecycle belongs to the language module
+	 * which owns it: call Load() right after the runtime is created and before the first stub is
+	 * generated, and Save() on shutdown while the runtime is still alive. Logging GetStats() after
+	 * both (loaded stubs and savedTime on start, compiled stubs on shutdown) shows if the cache pays off.
+	 *
+	 * @code
+	 * _rt = std::make_shared<asmjit::JitRuntime>();
+	 * auto cachePath = baseDir / JitStubCache::kFileName;
+	 * if (JitStubCache::Load(_rt, cachePath)) {
+	 *     auto stats = JitStubCache::GetStats(_rt);
+	 *     log(std::format("Loaded {} stubs, saved {}", stats.loaded, stats.savedTime));
+	 * }
+	 * // ... on shutdown, images of released stubs are kept, so only the runtime has to be alive
+	 * JitStubCache::Save(_rt, cachePath);
+	 * @endcode
+	 */
+	class JitStubCache {
+	public:
+		/**
+		 * @brief Kind of the generated stub, used to keep different generators apart.
+		 */
+		enum class Kind : uint8_t {
+			Call,
+			Callback,
+			BatchCall
+		};
+
+		/**
+		 * @struct Stats
+		 * @brief Counters of the stub cache for a runtime.
+		 */
+		struct Stats {
+			size_t compiled{}; ///< Stubs generated by the compiler.
+			size_t loaded{}; ///< Stubs restored from the saved images.
+			std::chrono::nanoseconds compileTime{}; ///< Time spent to generate stubs.
+			std::chrono::nanoseconds savedTime{}; ///< Compile time which restored stubs took originally.
+			size_t shared{}; ///< Shared stubs currently in use.
+		};
+
+		/**
+		 * @brief Build a key which uniquely identifies the generated code.
+		 * @param kind Kind of the stub.
+		 * @param sig Function signature.
+		 * @param extra Additional generator inputs which change the emitted code.
+		 * @return Key of the stub.
+		 */
+		static std::string MakeKey(Kind kind, const asmjit::FuncSignature& sig, std::initializer_list<uint64_t> extra);
+
+		/**
+		 * @brief Find the stub by key and take a reference to it.
+		 * @param rt Runtime which owns the stub.
+		 * @param key Key of the stub.
+		 * @return Pointer to the stub, or nullptr if it was neither generated nor loaded from disk yet.
+		 */
+		static void* Acquire(const std::shared_ptr<asmjit::JitRuntime>& rt, const std::string& key);
+
+		/**
+		 * @brief Store the newly generated stub and take a reference to it.
+		 * @param rt Runtime which owns the stub.
+		 * @param key Key of the stub.
+		 * @param function Generated stub.
+		 * @param size Size of the stub code, 0 if it can't be saved to disk.
+		 * @param compileTime Time spent to generate the stub.
+		 * @return Pointer to the interned stub. If another thread was faster, its stub is returned and the given one is released.
+		 */
+		static void* Insert(const std::shared_ptr<asmjit::JitRuntime>& rt, std::string key, void* function, size_t size, std::chrono::nanoseconds compileTime);
+
+		/**
+		 * @brief Drop a reference to the stub, the code is released when nobody uses it anymore.
+		 * @param rt Runtime which owns the stub.
+		 * @param function Pointer to the stub.
+		 */
+		static void Release(const std::shared_ptr<asmjit::JitRuntime>& rt, void* function);
+
+		/**
+		 * @brief Read stub images saved by a previous run.
+		 * @param rt Runtime which will own the restored stubs.
+		 * @param path Path to the cache file.
+		 * @return True if the file was loaded, false if it is missing, corrupted or made for another CPU, plugify or asmjit version.
+		 */
+		static bool Load(const std::shared_ptr<asmjit::JitRuntime>& rt, const std::filesystem::path& path);
+
+		/**
+		 * @brief Write images of every stub known to the runtime.
+		 * @param rt Runtime which owns the stubs.
+		 * @param path Path to the cache file.
+		 * @return True on success.
+		 */
+		static bool Save(const std::shared_ptr<asmjit::JitRuntime>& rt, const std::filesystem::path& path);
+
+		/**
+		 * @brief Get the counters of the runtime.
+		 * @param rt Runtime which owns the stubs.
+		 * @return Counters.
+		 */
+		static Stats GetStats(const std::shared_ptr<asmjit::JitRuntime>& rt);
+
+		/**
+		 * @brief Get the shared stub for the key and bind the slot values to it through a new thunk.
+		 * @tparam F Functor with `const char*(asmjit::JitRuntime&, void*&, size_t&)` signature which generates the stub on a cache miss.
+		 * @param rt Runtime which owns the stubs.
+		 * @param key Key of the stub.
+		 * @param slot Values which are available to the stub through the context register.
+		 * @param build Stub generator.
+		 * @param persistent False if the generated code embeds absolute addresses and must not be saved.
+		 * @param stub Receives the shared stub.
+		 * @param thunk Receives the per-instance thunk.
+		 * @return Error message, or nullptr on success.
+		 */
+		template<typename F>
+		static const char* Bind(const std::shared_ptr<asmjit::JitRuntime>& rt, std::string key, std::span<const uint64_t> slot, F&& build, bool persistent, void*& stub, void*& thunk) {
+			void* function = Acquire(rt, key);
+			if (!function) {
+				auto start = std::chrono::steady_clock::now();
+				size_t size = 0;
+				if (const char* error = build(*rt, function, size))
+					return error;
+				auto compileTime = std::chrono::steady_clock::now() - start;
+				function = Insert(rt, std::move(key), function, persistent ? size : 0, compileTime);
+			}
+
+			asmjit::Error err = JitUtils::CreateThunk(*rt, function, slot, thunk);
+			if (err) {
+				Release(rt, function);
+				return asmjit::DebugUtils::errorAsString(err);
+			}
+
+			stub = function;
+			return nullptr;
+		}
+
+		static inline std::string_view kFileName = "stubs.pcache";
+		static inline int32_t kFileVersion = 2;
+	};
+} // namespace plugify
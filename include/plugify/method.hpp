@@ -194,6 +194,8 @@ namespace plugify {
 		bool hasStart{}; ///< Boolean indicating if a start method exists.
 		bool hasEnd{}; ///< Boolean indicating if an end method exists.
 		bool hasExport{}; ///< Boolean indicating if a export methods exists.
+		bool hasParallelLoad{}; ///< Boolean indicating if a module allows to load and start its plugins concurrently.
+		bool hasParallelUpdate{}; ///< Boolean indicating if a module and its plugins can be updated on a worker thread, concurrently with other modules.
 	};
 
 } // namespace plugify
@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <optional>
+#include <plugify/date_time.hpp>
 #include <plugify/handle.hpp>
 #include <plugify/path.hpp>
 #include <plugify_export.h>
@@ -91,6 +92,12 @@ namespace plugify {
 		 */
 		std::string_view GetError() const noexcept;
 
+		/**
+		 * @brief Get the average time spent in the update of the language module and its plugins.
+		 * @return The exponentially weighted moving average of the update cost.
+		 */
+		DateTime GetUpdateCost() const noexcept;
+
 		/**
 		 * @brief Find a resource file associated with the module.
 		 *
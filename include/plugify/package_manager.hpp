@@ -3,6 +3,10 @@
 #include <filesystem>
 #include <functional>
 #include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
 #include <plugify_export.h>
 
 namespace plugify {
@@ -59,6 +63,14 @@ namespace plugify {
 		 */
 		virtual bool Reload() = 0;
 
+		/**
+		 * @brief Reads the descriptor of a single local package again.
+		 * @param packageName Name of the package to reload.
+		 * @return Shared pointer to the reloaded package, or nullptr if it was removed or became invalid.
+		 * @note Remote packages are not fetched again, use Reload for that.
+		 */
+		virtual LocalPackagePtr ReloadLocalPackage(std::string_view packageName) = 0;
+
 		/**
 		 * @brief Install a package.
 		 * @param packageName Name of the package to install.
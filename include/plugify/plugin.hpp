@@ -4,6 +4,7 @@
 #include <optional>
 #include <span>
 #include <string>
+#include <plugify/date_time.hpp>
 #include <plugify/handle.hpp>
 #include <plugify/mem_addr.hpp>
 #include <plugify/method.hpp>
@@ -98,6 +99,12 @@ namespace plugify {
 		 */
 		MemAddr GetData() const noexcept;
 
+		/**
+		 * @brief Get the average time spent in the plugin update.
+		 * @return The exponentially weighted moving average of the update cost.
+		 */
+		DateTime GetUpdateCost() const noexcept;
+
 		/**
 		 * @brief Find a resource file associated with the plugin.
 		 *
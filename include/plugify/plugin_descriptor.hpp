@@ -110,6 +110,13 @@ namespace plugify {
 		 */
 		std::string_view GetEntryPoint() const noexcept;
 
+		/**
+		 * @brief Retrieves the update divisor of the plugin.
+		 *
+		 * @return The plugin is updated on every N-th tick, 1 means every tick.
+		 */
+		uint32_t GetUpdateDivisor() const noexcept;
+
 		/**
 		 * @brief Retrieves the language module used by the plugin.
 		 *
@@ -48,6 +48,13 @@ namespace plugify {
 		 */
 		virtual void Update(DateTime dt) = 0;
 
+		/**
+		 * @brief Reload a single plugin and every plugin which depends on it, other plugins keep running.
+		 * @param pluginName Name of the plugin to reload.
+		 * @return True if the plugin is running again after the reload, false otherwise.
+		 */
+		virtual bool ReloadPlugin(std::string_view pluginName) = 0;
+
 		/**
 		 * @brief Find a module by name.
 		 * @param moduleName Name of the module to find.
@@ -0,0 +1,170 @@
+#include "descriptor_cache.hpp"
+
+#include <utils/file_system.hpp>
+#include <utils/json.hpp>
+#include <utils/sha256.hpp>
+
+using namespace plugify;
+
+static std::string GetPlugifyVersion() {
+	return std::format("{}.{}.{}", PLUGIFY_VERSION_MAJOR, PLUGIFY_VERSION_MINOR, PLUGIFY_VERSION_PATCH);
+}
+
+static std::string GetFileChecksum(const fs::path& path) {
+	std::string checksum;
+	FileSystem::ReadBytes(path, [&](std::span<const uint8_t> bytes) {
+		Sha256 sha;
+		sha.update(bytes);
+		checksum = Sha256::ToString(sha.digest());
+	});
+	return checksum;
+}
+
+DescriptorCache::DescriptorCache(fs::path filePath, bool useChecksum) : _filePath{std::move(filePath)}, _useChecksum{useChecksum} {
+}
+
+void DescriptorCache::Load() {
+	_entries.clear();
+
+	if (!FileSystem::IsExists(_filePath))
+		return;
+
+	auto buffer = FileSystem::ReadText(_filePath);
+
+	DescriptorCacheData data;
+	if (glz::read_beve(data, buffer)) {
+		PL_LOG_WARNING("Descriptor cache: '{}' is corrupted and will be rebuilt", _filePath.string());
+		return;
+	}
+
+	// Validation rules could be changed between versions, so never trust a foreign cache
+	if (data.fileVersion != kFileVersion || data.plugifyVersion != GetPlugifyVersion()) {
+		PL_LOG_VERBOSE("Descriptor cache: '{}' is outdated and will be rebuilt", _filePath.string());
+		return;
+	}
+
+	_entries.reserve(data.entries.size());
+	for (auto& entry : data.entries) {
+		if (!entry.plugin && !entry.module)
+			continue;
+		auto path = entry.path;
+		_entries.emplace(std::move(path), std::move(entry));
+	}
+}
+
+void DescriptorCache::Save() {
+	if (!_dirty)
+		return;
+
+	DescriptorCacheData data;
+	data.fileVersion = kFileVersion;
+	data.plugifyVersion = GetPlugifyVersion();
+	data.entries.reserve(_entries.size());
+	for (const auto& [_, entry] : _entries) {
+		data.entries.push_back(entry);
+	}
+
+	std::string buffer;
+	glz::write_beve(data, buffer);
+
+	if (FileSystem::WriteText(_filePath, buffer)) {
+		_dirty = false;
+	} else {
+		PL_LOG_WARNING("Descriptor cache: '{}' could not be written", _filePath.string());
+	}
+}
+
+void DescriptorCache::BeginScan() {
+	_scannedEntries.clear();
+	_hits = 0;
+	_misses = 0;
+}
+
+void DescriptorCache::EndScan() {
+	// Anything left behind belongs to removed descriptors
+	if (_scannedEntries.size() != _entries.size() || _misses != 0) {
+		_dirty = true;
+	}
+	_entries = std::move(_scannedEntries);
+	_scannedEntries.clear();
+}
+
+LocalPackagePtr DescriptorCache::Find(const fs::path& path, const std::string& name) {
+	auto key = path.generic_string();
+
+	auto it = _entries.find(key);
+	if (it == _entries.end()) {
+		++_misses;
+		return {};
+	}
+
+	const auto& cached = it->second;
+
+	DescriptorCacheEntry current;
+	if (!GetFileInfo(path, current) || current.lastWriteTime != cached.lastWriteTime || current.fileSize != cached.fileSize || current.checksum != cached.checksum) {
+		++_misses;
+		return {};
+	}
+
+	LocalPackagePtr package;
+	if (cached.module) {
+		cached.module->versionName = cached.module->version.to_string_noexcept();
+		package = std::make_shared<LocalPackage>(Package{name, cached.module->language}, path, cached.module->version, cached.module);
+	} else {
+		cached.plugin->versionName = cached.plugin->version.to_string_noexcept();
+		package = std::make_shared<LocalPackage>(Package{name, "plugin"}, path, cached.plugin->version, cached.plugin);
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_scannedEntries.emplace(std::move(key), cached);
+	}
+
+	++_hits;
+	return package;
+}
+
+void DescriptorCache::Store(const fs::path& path, const LocalPackagePtr& package) {
+	DescriptorCacheEntry entry;
+	if (!GetFileInfo(path, entry))
+		return;
+
+	entry.path = path.generic_string();
+	if (package->type == "plugin") {
+		entry.plugin = std::static_pointer_cast<PluginDescriptor>(package->descriptor);
+	} else {
+		entry.module = std::static_pointer_cast<LanguageModuleDescriptor>(package->descriptor);
+	}
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	auto key = entry.path;
+	_scannedEntries.insert_or_assign(std::move(key), std::move(entry));
+}
+
+void DescriptorCache::Keep(const fs::path& path) {
+	auto key = path.generic_string();
+
+	auto it = _entries.find(key);
+	if (it == _entries.end())
+		return;
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	_scannedEntries.emplace(std::move(key), it->second);
+}
+
+bool DescriptorCache::GetFileInfo(const fs::path& path, DescriptorCacheEntry& entry) const {
+	std::error_code ec;
+	auto lastWriteTime = fs::last_write_time(path, ec);
+	if (ec)
+		return false;
+	auto fileSize = fs::file_size(path, ec);
+	if (ec)
+		return false;
+
+	entry.lastWriteTime = static_cast<int64_t>(lastWriteTime.time_since_epoch().count());
+	entry.fileSize = static_cast<uint64_t>(fileSize);
+	if (_useChecksum) {
+		entry.checksum = GetFileChecksum(path);
+	}
+	return true;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "language_module_descriptor.hpp"
+#include "plugin_descriptor.hpp"
+#include <plugify/package.hpp>
+#include <plugify/package_manager.hpp>
+#include <utils/hash.hpp>
+
+namespace plugify {
+	struct DescriptorCacheEntry {
+		std::string path;
+		int64_t lastWriteTime{};
+		uint64_t fileSize{};
+		std::string checksum;
+		std::shared_ptr<PluginDescriptor> plugin;
+		std::shared_ptr<LanguageModuleDescriptor> module;
+	};
+
+	struct DescriptorCacheData {
+		int32_t fileVersion{};
+		std::string plugifyVersion;
+		std::vector<DescriptorCacheEntry> entries;
+	};
+
+	class DescriptorCache {
+	public:
+		DescriptorCache(fs::path filePath, bool useChecksum);
+
+		void Load();
+		void Save();
+
+		// Starts a new scan of the descriptors, entries which are not touched until the end of scan are dropped
+		void BeginScan();
+		void EndScan();
+
+		// Find and Store are safe to call concurrently between BeginScan and EndScan
+		LocalPackagePtr Find(const fs::path& path, const std::string& name);
+		void Store(const fs::path& path, const LocalPackagePtr& package);
+		// Keeps the entry of a descriptor which is known to be unchanged since the previous scan
+		void Keep(const fs::path& path);
+
+		size_t GetHits() const noexcept {
+			return _hits;
+		}
+
+		size_t GetMisses() const noexcept {
+			return _misses;
+		}
+
+		static inline std::string_view kFileName = "descriptors.pcache";
+		static inline int32_t kFileVersion = 2;
+
+	private:
+		bool GetFileInfo(const fs::path& path, DescriptorCacheEntry& entry) const;
+
+	private:
+		using EntryMap = std::unordered_map<std::string, DescriptorCacheEntry, string_hash, std::equal_to<>>;
+
+		fs::path _filePath;
+		EntryMap _entries;
+		EntryMap _scannedEntries;
+		std::mutex _mutex;
+		std::atomic<size_t> _hits{ 0 };
+		std::atomic<size_t> _misses{ 0 };
+		bool _useChecksum{ false };
+		bool _dirty{ false };
+	};
+}
@@ -0,0 +1,126 @@
+#if PLUGIFY_DOWNLOADER
+
+#include "manifest_cache.hpp"
+
+#include <utils/file_system.hpp>
+#include <utils/json.hpp>
+
+using namespace plugify;
+
+ManifestCache::ManifestCache(fs::path filePath, double ttl) : _filePath{std::move(filePath)}, _ttl{ttl} {
+}
+
+void ManifestCache::Load() {
+	_entries.clear();
+
+	if (!FileSystem::IsExists(_filePath))
+		return;
+
+	auto buffer = FileSystem::ReadText(_filePath);
+
+	ManifestCacheData data;
+	if (glz::read_beve(data, buffer) || data.fileVersion != kFileVersion) {
+		PL_LOG_VERBOSE("Manifest cache: '{}' is outdated or corrupted and will be rebuilt", _filePath.string());
+		return;
+	}
+
+	_entries.reserve(data.entries.size());
+	for (auto& entry : data.entries) {
+		auto url = entry.url;
+		_entries.emplace(std::move(url), std::move(entry));
+	}
+}
+
+void ManifestCache::Save() {
+	if (!_dirty)
+		return;
+
+	ManifestCacheData data;
+	data.fileVersion = kFileVersion;
+	data.entries.reserve(_entries.size());
+	for (const auto& [_, entry] : _entries) {
+		data.entries.push_back(entry);
+	}
+
+	std::string buffer;
+	glz::write_beve(data, buffer);
+
+	if (FileSystem::WriteText(_filePath, buffer)) {
+		_dirty = false;
+	} else {
+		PL_LOG_WARNING("Manifest cache: '{}' could not be written", _filePath.string());
+	}
+}
+
+const ManifestCacheEntry* ManifestCache::Find(std::string_view url) const {
+	auto it = _entries.find(url);
+	return it != _entries.end() ? &it->second : nullptr;
+}
+
+bool ManifestCache::IsFresh(const ManifestCacheEntry& entry) const {
+	if (_ttl <= 0)
+		return false;
+	auto age = GetCurrentTime() - entry.fetchTime;
+	return age >= 0 && static_cast<double>(age) < _ttl;
+}
+
+std::shared_ptr<PackageManifest> ManifestCache::GetManifest(std::string_view url) {
+	auto it = _entries.find(url);
+	if (it == _entries.end())
+		return {};
+
+	auto manifest = Parse(it);
+	if (manifest) {
+		++_hits;
+	}
+	return manifest;
+}
+
+std::shared_ptr<PackageManifest> ManifestCache::Revalidate(std::string_view url) {
+	auto it = _entries.find(url);
+	if (it == _entries.end())
+		return {};
+
+	// Entry is refreshed only once its body turned out to be usable, a broken one is already gone
+	auto manifest = Parse(it);
+	if (!manifest)
+		return {};
+
+	it->second.fetchTime = GetCurrentTime();
+	_dirty = true;
+	++_revalidations;
+	return manifest;
+}
+
+std::shared_ptr<PackageManifest> ManifestCache::Parse(EntryMap::iterator it) {
+	auto& entry = it->second;
+	if (!entry.manifest) {
+		auto manifest = glz::read_jsonc<PackageManifest>(entry.body);
+		if (!manifest.has_value()) {
+			PL_LOG_ERROR("Manifest cache: body of '{}' has JSON parsing error: {}", entry.url, glz::format_error(manifest.error(), entry.body));
+			_entries.erase(it);
+			_dirty = true;
+			return {};
+		}
+		entry.manifest = std::make_shared<PackageManifest>(std::move(*manifest));
+	}
+	return entry.manifest;
+}
+
+void ManifestCache::Store(std::string url, std::string etag, std::string lastModified, std::string body, std::shared_ptr<PackageManifest> manifest) {
+	// Without validators or TTL the body could never be reused
+	if (etag.empty() && lastModified.empty() && _ttl <= 0) {
+		_dirty |= _entries.erase(url) != 0;
+		return;
+	}
+
+	ManifestCacheEntry entry{ url, std::move(etag), std::move(lastModified), GetCurrentTime(), std::move(body), std::move(manifest) };
+	_entries.insert_or_assign(std::move(url), std::move(entry));
+	_dirty = true;
+}
+
+int64_t ManifestCache::GetCurrentTime() {
+	return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+#endif // PLUGIFY_DOWNLOADER
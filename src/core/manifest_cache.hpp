@@ -0,0 +1,68 @@
+#pragma once
+
+#include "package_manifest.hpp"
+#include <utils/hash.hpp>
+
+namespace plugify {
+	struct ManifestCacheEntry {
+		std::string url;
+		std::string etag;
+		std::string lastModified;
+		int64_t fetchTime{};
+		std::string body;
+		std::shared_ptr<PackageManifest> manifest; // parsed on first use, never stored
+	};
+
+	struct ManifestCacheData {
+		int32_t fileVersion{};
+		std::vector<ManifestCacheEntry> entries;
+	};
+
+	class ManifestCache {
+	public:
+		/**
+		 * @param filePath Location of the cache file.
+		 * @param ttl Seconds during which a cached manifest is used without asking the server, 0 to always revalidate.
+		 */
+		ManifestCache(fs::path filePath, double ttl);
+
+		void Load();
+		void Save();
+
+		const ManifestCacheEntry* Find(std::string_view url) const;
+		bool IsFresh(const ManifestCacheEntry& entry) const;
+
+		// Parsed manifest of the cached body, nullptr if it cannot be parsed
+		std::shared_ptr<PackageManifest> GetManifest(std::string_view url);
+		// Server confirmed the cached body is still valid (304), nullptr and the entry is dropped if it cannot be parsed
+		std::shared_ptr<PackageManifest> Revalidate(std::string_view url);
+		void Store(std::string url, std::string etag, std::string lastModified, std::string body, std::shared_ptr<PackageManifest> manifest);
+
+		size_t GetHits() const noexcept {
+			return _hits;
+		}
+
+		size_t GetRevalidations() const noexcept {
+			return _revalidations;
+		}
+
+		static inline std::string_view kFileName = "manifests.pcache";
+		static inline int32_t kFileVersion = 1;
+
+	private:
+		using EntryMap = std::unordered_map<std::string, ManifestCacheEntry, string_hash, std::equal_to<>>;
+
+		// Parses the body once, an entry which cannot be parsed is erased
+		std::shared_ptr<PackageManifest> Parse(EntryMap::iterator it);
+		static int64_t GetCurrentTime();
+
+	private:
+
+		fs::path _filePath;
+		EntryMap _entries;
+		double _ttl{};
+		size_t _hits{};
+		size_t _revalidations{};
+		bool _dirty{ false };
+	};
+}
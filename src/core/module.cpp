@@ -250,6 +250,8 @@ Module& Module::operator=(Module&& other) noexcept {
 	_state = other._state;
 	_table = other._table;
 	_id = other._id;
+	_updateCost = other._updateCost;
+	_updateTime = other._updateTime;
 
 	_name = std::move(other._name);
 	_lang = std::move(other._lang);
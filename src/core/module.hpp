@@ -1,6 +1,7 @@
 #pragma once
 
 #include "language_module_descriptor.hpp"
+#include "update_cost.hpp"
 #include <plugify/assembly.hpp>
 #include <plugify/language_module.hpp>
 #include <plugify/module.hpp>
@@ -68,6 +69,28 @@ namespace plugify {
 
 		void SetError(std::string error);
 
+		bool HasParallelLoad() const noexcept {
+			return _table.hasParallelLoad;
+		}
+
+		bool HasParallelUpdate() const noexcept {
+			return _table.hasParallelUpdate;
+		}
+
+		DateTime GetUpdateCost() const noexcept {
+			return _updateCost;
+		}
+
+		// Module and its plugins are accounted together, so the cost is gathered during the tick
+		void AddUpdateTime(DateTime time) noexcept {
+			_updateTime += time;
+		}
+
+		void CommitUpdateTime() noexcept {
+			_updateCost = _updateCost == DateTime{} ? _updateTime : _updateCost + (_updateTime - _updateCost) * kUpdateCostFactor;
+			_updateTime = {};
+		}
+
 		ILanguageModule* GetLanguageModule() const {
 			return _languageModule;
 		}
@@ -90,6 +113,8 @@ namespace plugify {
 		ModuleState _state{ ModuleState::NotLoaded };
 		MethodTable _table;
 		UniqueId _id;
+		DateTime _updateCost;
+		DateTime _updateTime;
 		std::string _name;
 		std::string _lang;
 		fs::path _filePath;
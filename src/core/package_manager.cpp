@@ -1,4 +1,6 @@
 #include "package_manager.hpp"
+#include "descriptor_cache.hpp"
+#include "manifest_cache.hpp"
 #include "module.hpp"
 #include "package_manifest.hpp"
 #include "plugin.hpp"
@@ -8,9 +10,9 @@
 #include <utils/file_system.hpp>
 #include <utils/json.hpp>
 #include <utils/strings.hpp>
+#include <utils/thread_pool.hpp>
 #if PLUGIFY_DOWNLOADER
 #include <utils/http_downloader.hpp>
-#include <utils/sha256.hpp>
 #endif // PLUGIFY_DOWNLOADER
 
 using namespace plugify;
@@ -38,7 +40,25 @@ bool PackageManager::Initialize() {
 	_httpDownloader = IHTTPDownloader::Create();
 #endif // PLUGIFY_DOWNLOADER
 
-	LoadAllPackages();
+	if (auto plugify = _plugify.lock()) {
+		const auto& config = plugify->GetConfig();
+		if (config.descriptorCache.value_or(false)) {
+			_descriptorCache = std::make_unique<DescriptorCache>(config.baseDir / DescriptorCache::kFileName, config.descriptorCacheChecksum.value_or(false));
+			_descriptorCache->Load();
+		}
+#if PLUGIFY_DOWNLOADER
+		if (_httpDownloader) {
+			_httpDownloader->SetRetryPolicy(config.downloadRetries.value_or(3), static_cast<float>(config.downloadRetryDelay.value_or(1.0)));
+			_httpDownloader->SetMaxBytesPerSecond(config.downloadSpeedLimit.value_or(0));
+		}
+		if (config.manifestCache.value_or(false)) {
+			_manifestCache = std::make_unique<ManifestCache>(config.baseDir / ManifestCache::kFileName, config.manifestCacheTTL.value_or(0));
+			_manifestCache->Load();
+		}
+#endif // PLUGIFY_DOWNLOADER
+	}
+
+	LoadAllPackages(false);
 
 	_inited = true;
 
@@ -54,8 +74,16 @@ void PackageManager::Terminate() {
 	_remotePackages.clear();
 	_missedPackages.clear();
 	_conflictedPackages.clear();
+	_localFiles.clear();
+#if PLUGIFY_DOWNLOADER
+	_dependencyResults.clear();
+	_savedRoundTrips = 0;
+#endif // PLUGIFY_DOWNLOADER
+
+	_descriptorCache.reset();
 
 #if PLUGIFY_DOWNLOADER
+	_manifestCache.reset();
 	_httpDownloader.reset();
 #endif // PLUGIFY_DOWNLOADER
 
@@ -70,16 +98,24 @@ bool PackageManager::Reload() {
 	if (!IsInitialized())
 		return false;
 
-	LoadAllPackages();
+	auto debugStart = DateTime::Now();
+
+	LoadAllPackages(true);
 
+	PL_LOG_DEBUG("PackageManager reloaded in {}ms", (DateTime::Now() - debugStart).AsMilliseconds<float>());
 	return true;
 }
 
-void PackageManager::LoadAllPackages() {
-	LoadLocalPackages();
+void PackageManager::LoadAllPackages([[maybe_unused]] bool incremental) {
+	auto changed = LoadLocalPackages();
 #if PLUGIFY_DOWNLOADER
-	LoadRemotePackages();
-	FindDependencies();
+	if (incremental) {
+		LoadRemotePackages(&changed);
+		FindDependencies(&changed);
+	} else {
+		LoadRemotePackages();
+		FindDependencies();
+	}
 #endif // PLUGIFY_DOWNLOADER
 }
 
@@ -261,6 +297,9 @@ LocalPackagePtr GetPackageFromDescriptor(const fs::path& path, const std::string
 		if (descriptor->languageModule.name.empty()) {
 			errors.emplace_back("Missing language name");
 		}
+		if (descriptor->updateDivisor == 0u) {
+			errors.emplace_back("Invalid update divisor");
+		}
 
 		if (auto& dependencies = descriptor->dependencies) {
 			ValidateDependencies(name, errors, *dependencies);
@@ -286,14 +325,24 @@ LocalPackagePtr GetPackageFromDescriptor(const fs::path& path, const std::string
 	return std::make_shared<LocalPackage>(Package{name, type}, path, std::move(version), std::move(descriptor));
 }
 
-void PackageManager::LoadLocalPackages()  {
+PackageManager::NameSet PackageManager::LoadLocalPackages() {
 	auto plugify = _plugify.lock();
 	PL_ASSERT(plugify);
 
 	PL_LOG_DEBUG("Loading local packages");
 
 	_localPackages.clear();
-	//_localPackages.reserve()
+
+	struct DescriptorFile {
+		fs::path path;
+		std::string key;
+		std::string name;
+		int64_t lastWriteTime;
+		uint64_t fileSize;
+		bool isModule;
+	};
+
+	std::vector<DescriptorFile> files;
 
 	FileSystem::ReadDirectory(plugify->GetConfig().baseDir, [&](const fs::path& path, int depth) {
 		if (depth != 1)
@@ -308,35 +357,198 @@ void PackageManager::LoadLocalPackages()  {
 		if (name.empty())
 			return;
 
-		auto package = isModule ?
-				GetPackageFromDescriptor<LanguageModuleDescriptor>(path, name) :
-				GetPackageFromDescriptor<PluginDescriptor>(path, name);
+		std::error_code ec;
+		auto lastWriteTime = fs::last_write_time(path, ec);
+		auto fileSize = fs::file_size(path, ec);
+
+		files.emplace_back(DescriptorFile{ path, path.generic_string(), std::move(name), static_cast<int64_t>(lastWriteTime.time_since_epoch().count()), static_cast<uint64_t>(fileSize), isModule });
+	}, 3);
+
+	// Directory iteration order is filesystem dependent, keep the result stable
+	std::sort(files.begin(), files.end(), [](const DescriptorFile& lhs, const DescriptorFile& rhs) {
+		return lhs.path < rhs.path;
+	});
+
+	auto* cache = _descriptorCache.get();
+	if (cache) {
+		cache->BeginScan();
+	}
+
+	NameSet changed;
+	std::vector<LocalPackagePtr> packages(files.size());
+	std::vector<size_t> pending;
+	pending.reserve(files.size());
+
+	// Descriptors which are untouched since the previous scan are reused as is
+	for (size_t i = 0; i < files.size(); ++i) {
+		const auto& file = files[i];
+
+		auto it = _localFiles.find(file.key);
+		if (it != _localFiles.end()) {
+			const auto& localFile = it->second;
+			if (localFile.lastWriteTime == file.lastWriteTime && localFile.fileSize == file.fileSize) {
+				packages[i] = localFile.package;
+				if (cache && packages[i]) {
+					cache->Keep(file.path);
+				}
+			} else {
+				changed.insert(localFile.name);
+				if (localFile.package && file.isModule) {
+					changed.insert(localFile.package->type);
+				}
+				pending.push_back(i);
+			}
+			_localFiles.erase(it);
+		} else {
+			changed.insert(file.name);
+			pending.push_back(i);
+		}
+	}
+
+	// Whatever is left was removed since the previous scan
+	for (const auto& [_, localFile] : _localFiles) {
+		changed.insert(localFile.name);
+		if (localFile.package && localFile.package->type != "plugin") {
+			changed.insert(localFile.package->type);
+		}
+	}
+	size_t removedCount = _localFiles.size();
+	_localFiles.clear();
+
+	auto parse = [&files, &packages, cache](size_t i) {
+		const auto& file = files[i];
+		if (cache) {
+			if (auto package = cache->Find(file.path, file.name)) {
+				packages[i] = std::move(package);
+				return;
+			}
+		}
+		packages[i] = file.isModule ?
+				GetPackageFromDescriptor<LanguageModuleDescriptor>(file.path, file.name) :
+				GetPackageFromDescriptor<PluginDescriptor>(file.path, file.name);
+		if (cache && packages[i]) {
+			cache->Store(file.path, packages[i]);
+		}
+	};
+
+	size_t threadCount = plugify->GetConfig().workerThreads.value_or(0);
+	if (threadCount == 0) {
+		threadCount = ThreadPool::GetDefaultThreadCount();
+	}
+	threadCount = std::min(threadCount, pending.size());
+
+	if (threadCount > 1) {
+		ThreadPool pool(threadCount);
+		for (size_t i : pending) {
+			pool.Enqueue([&parse, i] { parse(i); });
+		}
+		pool.Wait();
+	} else {
+		for (size_t i : pending) {
+			parse(i);
+		}
+	}
+
+	if (cache) {
+		cache->EndScan();
+		cache->Save();
+		PL_LOG_DEBUG("Descriptor cache: {} hit(s), {} miss(es)", cache->GetHits(), cache->GetMisses());
+	}
+
+	for (size_t i : pending) {
+		// Plugins refer to language modules by language name
+		if (files[i].isModule && packages[i]) {
+			changed.insert(packages[i]->type);
+		}
+	}
+
+	PL_LOG_DEBUG("Local descriptors: {} parsed, {} reused, {} removed", pending.size(), files.size() - pending.size(), removedCount);
+
+	_localFiles.reserve(files.size());
+	_localPackages.reserve(files.size());
+
+	for (size_t i = 0; i < files.size(); ++i) {
+		auto& file = files[i];
+		auto& package = packages[i];
+
+		_localFiles.emplace(std::move(file.key), LocalFile{ file.name, file.lastWriteTime, file.fileSize, package });
+
 		if (!package)
-			return;
+			continue;
 
-		auto it = _localPackages.find(name);
+		auto it = _localPackages.find(file.name);
 		if (it == _localPackages.end()) {
-			_localPackages.emplace(std::move(name), std::move(package));
+			_localPackages.emplace(std::move(file.name), std::move(package));
 		} else {
 			auto& [_, existingPackage] = *it;
 
 			auto& existingVersion = existingPackage->version;
 			if (existingVersion != package->version) {
-				PL_LOG_WARNING("By default, prioritizing newer version (v{}) of '{}' package, over older version (v{}).", std::max(existingVersion, package->version), name, std::min(existingVersion, package->version));
+				PL_LOG_WARNING("By default, prioritizing newer version (v{}) of '{}' package, over older version (v{}).", std::max(existingVersion, package->version), file.name, std::min(existingVersion, package->version));
 
 				if (existingVersion < package->version) {
 					existingPackage = std::move(package);
 				}
 			} else {
-				PL_LOG_VERBOSE("The same version (v{}) of package '{}' exists at '{}' - second location will be ignored.", existingVersion, name, path.string());
+				PL_LOG_VERBOSE("The same version (v{}) of package '{}' exists at '{}' - second location will be ignored.", existingVersion, file.name, file.path.string());
 			}
 		}
-	}, 3);
+	}
+
+	return changed;
+}
+
+LocalPackagePtr PackageManager::ReloadLocalPackage(std::string_view packageName) {
+	if (!IsInitialized())
+		return {};
+
+	auto it = _localPackages.find(packageName);
+	if (it == _localPackages.end())
+		return {};
+
+	std::string name(packageName);
+	fs::path path = it->second->path;
+	bool isModule = it->second->type != "plugin";
+
+	LocalPackagePtr package;
+	std::error_code ec;
+	auto lastWriteTime = fs::last_write_time(path, ec);
+	auto fileSize = fs::file_size(path, ec);
+	if (!ec) {
+		package = isModule ?
+				GetPackageFromDescriptor<LanguageModuleDescriptor>(path, name) :
+				GetPackageFromDescriptor<PluginDescriptor>(path, name);
+	}
+
+	// Next full reload sees the file as unchanged and keeps this result
+	auto key = path.generic_string();
+	if (ec) {
+		_localFiles.erase(key);
+	} else {
+		_localFiles.insert_or_assign(std::move(key), LocalFile{ name, static_cast<int64_t>(lastWriteTime.time_since_epoch().count()), static_cast<uint64_t>(fileSize), package });
+	}
+
+	if (package) {
+		it->second = package;
+	} else {
+		_localPackages.erase(it);
+	}
+
+#if PLUGIFY_DOWNLOADER
+	// Dependencies are checked against the remote packages which are already known
+	NameSet changed{ std::move(name) };
+	if (isModule && package) {
+		changed.insert(package->type);
+	}
+	FindDependencies(&changed);
+#endif // PLUGIFY_DOWNLOADER
+
+	return package;
 }
 
 #if PLUGIFY_DOWNLOADER
 
-void PackageManager::LoadRemotePackages() {
+void PackageManager::LoadRemotePackages(NameSet* changed) {
 	auto plugify = _plugify.lock();
 	PL_ASSERT(plugify);
 
@@ -344,61 +556,123 @@ void PackageManager::LoadRemotePackages() {
 
 	const auto& repositories = plugify->GetConfig().repositories;
 
+	// Remote packages are rebuilt on every load, so withdrawn versions and packages are dropped,
+	// the previous set is kept only to find out what changed
+	auto previousPackages = std::move(_remotePackages);
 	_remotePackages.clear();
 	_remotePackages.reserve(repositories.size() + _localPackages.size());
+	if (!changed) {
+		previousPackages.clear();
+	}
 
 	std::mutex mutex;
 
+	// Packages of one bundle usually share an update URL, every URL is fetched once and merged for all of them
+	NameSet requested;
+	size_t coalesced = 0;
+	size_t cached = 0;
+
+	// Packages are copied, so the manifest can stay in cache untouched
+	auto mergeManifest = [&](const std::string& url, const PackageManifest& manifest) {
+		for (const auto& [name, source] : manifest.content) {
+			if (name.empty() || !source || source->name != name) {
+				PL_LOG_ERROR("Package manifest: '{}' has different name in key and object: {} <-> {}", url, name, source ? source->name : "<null>");
+				continue;
+			}
+			auto package = std::make_shared<RemotePackage>(*source);
+			RemoveUnsupported(package);
+			if (package->versions.empty()) {
+				PL_LOG_ERROR("Package manifest: '{}' has empty version list at '{}'", url, name);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(mutex);
+			auto it = _remotePackages.find(name);
+			if (it == _remotePackages.end()) {
+				_remotePackages.emplace(name, std::move(package));
+			} else {
+				auto& [_, existingPackage] = *it;
+				if (*existingPackage == *package) {
+					existingPackage->versions.merge(package->versions);
+				} else {
+					PL_LOG_VERBOSE("The package '{}' exists at '{}' - second location will be ignored.", name, url);
+				}
+			}
+		}
+	};
+
 	auto fetchManifest = [&](const std::string& url, const std::shared_ptr<Descriptor>& descriptor = nullptr) {
 		if (!String::IsValidURL(url)) {
 			PL_LOG_VERBOSE("Tried to fetch a package: '{}' that is not have valid url: \"{}\", aborting",
 						   descriptor ? descriptor->friendlyName : "<from config>", url.empty() ? "<empty>" : url);
 			return;
 		}
-		
-		_httpDownloader->CreateRequest(url, [&](int32_t statusCode, std::string_view, IHTTPDownloader::Request::Data data) {
-			if (statusCode == IHTTPDownloader::HTTP_STATUS_OK) {
-				/*if (contentType != "text/plain" || contentType != "application/json" || contentType != "text/json" || contentType != "text/javascript") {
-					PL_LOG_ERROR("Package manifest: '{}' should be in text format to be read correctly", url);
-					return;
-				}*/
-
-				std::string buffer(data.begin(), data.end());
-				auto manifest = glz::read_jsonc<PackageManifest>(buffer);
-				if (!manifest.has_value()) {
-					PL_LOG_ERROR("Packages manifest from '{}' has JSON parsing error: {}", url, glz::format_error(manifest.error(), buffer));
-					return;
-				}
 
-				for (auto& [name, package] : manifest->content) {
-					if (name.empty() || package->name != name) {
-						PL_LOG_ERROR("Package manifest: '{}' has different name in key and object: {} <-> {}", url, name, package->name);
-						continue;
-					}
-					RemoveUnsupported(package);
-					if (package->versions.empty()) {
-						PL_LOG_ERROR("Package manifest: '{}' has empty version list at '{}'", url, name);
-						continue;
-					}
+		if (!requested.emplace(url).second) {
+			++coalesced;
+			return;
+		}
 
-					auto it = _remotePackages.find(name);
-					if (it == _remotePackages.end()) {
-						std::unique_lock<std::mutex> lock(mutex);
-						_remotePackages.emplace(name, std::move(package));
-					} else {
-						auto& [_, existingPackage] = *it;
-						if (existingPackage == package) {
-							std::unique_lock<std::mutex> lock(mutex);
-							existingPackage->versions.merge(package->versions);
-						} else {
-							PL_LOG_VERBOSE("The package '{}' exists at '{}' - second location will be ignored.", name, url);
-						}
+		IHTTPDownloader::Validators condition;
+		if (_manifestCache) {
+			if (const auto* entry = _manifestCache->Find(url)) {
+				// Within TTL the server is not asked at all
+				if (_manifestCache->IsFresh(*entry)) {
+					if (auto manifest = _manifestCache->GetManifest(url)) {
+						PL_LOG_VERBOSE("Package manifest: '{}' is taken from cache", url);
+						mergeManifest(url, *manifest);
+						++cached;
+						return;
 					}
+				} else {
+					condition = { entry->etag, entry->lastModified };
 				}
 			}
+		}
+
+		auto receiveManifest = [&, url](int32_t statusCode, IHTTPDownloader::Request::Data data, IHTTPDownloader::Validators validators) {
+			if (statusCode != IHTTPDownloader::HTTP_STATUS_OK)
+				return;
+
+			/*if (contentType != "text/plain" || contentType != "application/json" || contentType != "text/json" || contentType != "text/javascript") {
+				PL_LOG_ERROR("Package manifest: '{}' should be in text format to be read correctly", url);
+				return;
+			}*/
+
+			std::string buffer(data.begin(), data.end());
+			auto manifest = glz::read_jsonc<PackageManifest>(buffer);
+			if (!manifest.has_value()) {
+				PL_LOG_ERROR("Packages manifest from '{}' has JSON parsing error: {}", url, glz::format_error(manifest.error(), buffer));
+				return;
+			}
+
+			auto parsed = std::make_shared<PackageManifest>(std::move(*manifest));
+			mergeManifest(url, *parsed);
+
+			if (_manifestCache) {
+				_manifestCache->Store(url, std::move(validators.etag), std::move(validators.lastModified), std::move(buffer), std::move(parsed));
+			}
+		};
+
+		_httpDownloader->CreateConditionalRequest(url, std::move(condition), [&, url, receiveManifest](int32_t statusCode, std::string_view, IHTTPDownloader::Request::Data data, IHTTPDownloader::Validators validators) {
+			if (statusCode == IHTTPDownloader::HTTP_STATUS_NOT_MODIFIED && _manifestCache) {
+				if (auto manifest = _manifestCache->Revalidate(url)) {
+					PL_LOG_VERBOSE("Package manifest: '{}' is not modified", url);
+					mergeManifest(url, *manifest);
+				} else {
+					// Cached body is gone or broken, so the server has to send it again in full
+					PL_LOG_WARNING("Package manifest: '{}' is not modified, but the cached copy is unusable, requesting it again", url);
+					_httpDownloader->CreateConditionalRequest(url, {}, [receiveManifest](int32_t retryStatusCode, std::string_view, IHTTPDownloader::Request::Data retryData, IHTTPDownloader::Validators retryValidators) {
+						receiveManifest(retryStatusCode, std::move(retryData), std::move(retryValidators));
+					});
+				}
+			} else {
+				receiveManifest(statusCode, std::move(data), std::move(validators));
+			}
 		});
 	};
 
+	// Repositories are revalidated on every load, the manifest cache turns unchanged ones into conditional requests
 	for (const auto& url : repositories) {
 		fetchManifest(url);
 	}
@@ -412,84 +686,168 @@ void PackageManager::LoadRemotePackages() {
 	//FetchPackagesListFromAPI(mutex);
 
 	_httpDownloader->WaitForAllRequests();
+
+	if (changed) {
+		auto isSameVersions = [](const RemotePackage& lhs, const RemotePackage& rhs) {
+			return std::equal(lhs.versions.begin(), lhs.versions.end(), rhs.versions.begin(), rhs.versions.end(), [](const PackageVersion& a, const PackageVersion& b) {
+				return !(a < b) && !(b < a);
+			});
+		};
+
+		for (const auto& [name, package] : _remotePackages) {
+			auto it = previousPackages.find(name);
+			if (it == previousPackages.end() || !isSameVersions(*it->second, *package)) {
+				changed->insert(name);
+			}
+		}
+
+		for (const auto& [name, _] : previousPackages) {
+			if (!_remotePackages.contains(name)) {
+				changed->insert(name);
+			}
+		}
+	}
+
+	_savedRoundTrips += coalesced + cached;
+	PL_LOG_DEBUG("Package manifests: {} requested, {} coalesced, {} taken from cache ({} round trips saved in total)", requested.size() - cached, coalesced, cached, _savedRoundTrips);
+
+	if (_manifestCache) {
+		PL_LOG_VERBOSE("Manifest cache: {} used, {} revalidated", _manifestCache->GetHits(), _manifestCache->GetRevalidations());
+		_manifestCache->Save();
+	}
 }
 
-template<typename T>
-T FindLanguageModule(const std::unordered_map<std::string, T, string_hash, std::equal_to<>>& container, const std::string& name)  {
-	for (const auto& [_, package] : container) {
-		if (package->type == name) {
-			return package;
+static bool IsAffectedBy(const std::string& name, const PluginDescriptor& descriptor, const PackageManager::NameSet& changed) {
+	if (changed.contains(name) || changed.contains(descriptor.languageModule.name))
+		return true;
+
+	if (const auto& dependencies = descriptor.dependencies) {
+		for (const auto& dependency : *dependencies) {
+			if (changed.contains(dependency.name))
+				return true;
 		}
 	}
-	return {};
+
+	return false;
 }
 
-void PackageManager::FindDependencies() {
-	_missedPackages.clear();
-	_conflictedPackages.clear();
+void PackageManager::FindDependencies(const NameSet* changed) {
+	if (!changed) {
+		_dependencyResults.clear();
+	}
+
+	// Forget about plugins which are no longer installed
+	for (auto it = _dependencyResults.begin(); it != _dependencyResults.end();) {
+		auto itl = _localPackages.find(it->first);
+		if (itl == _localPackages.end() || itl->second->type != "plugin") {
+			it = _dependencyResults.erase(it);
+		} else {
+			++it;
+		}
+	}
+
+	std::unordered_set<std::string_view> localLanguages;
+	for (const auto& [_, package] : _localPackages) {
+		if (package->type != "plugin") {
+			localLanguages.emplace(package->type);
+		}
+	}
+
+	std::unordered_map<std::string_view, RemotePackagePtr> remoteLanguages;
+	for (const auto& [_, package] : _remotePackages) {
+		if (package->type != "plugin") {
+			remoteLanguages.try_emplace(package->type, package);
+		}
+	}
+
+	size_t resolvedCount = 0;
 
 	for (const auto& [name, package] : _localPackages) {
-		if (package->type == "plugin") {
-			auto pluginDescriptor = std::static_pointer_cast<PluginDescriptor>(package->descriptor);
+		if (package->type != "plugin")
+			continue;
 
-			const auto& lang = pluginDescriptor->languageModule.name;
-			if (!FindLanguageModule(_localPackages, lang)) {
-				if (auto remotePackage = FindLanguageModule(_remotePackages, lang); remotePackage) {
-					_missedPackages.try_emplace(lang, std::pair{ std::move(remotePackage), std::nullopt }); // by default prioritizing latest language modules
-				} else {
-					PL_LOG_ERROR("Package: '{}' has language module dependency: '{}', but it was not found.", package->name, lang);
-					_conflictedPackages.emplace_back(package);
-					continue;
-				}
+		auto pluginDescriptor = std::static_pointer_cast<PluginDescriptor>(package->descriptor);
+
+		if (changed && _dependencyResults.contains(name) && !IsAffectedBy(name, *pluginDescriptor, *changed))
+			continue;
+
+		auto& result = _dependencyResults[name];
+		result = {};
+		++resolvedCount;
+
+		const auto& lang = pluginDescriptor->languageModule.name;
+		if (!localLanguages.contains(lang)) {
+			if (auto it = remoteLanguages.find(lang); it != remoteLanguages.end()) {
+				result.missed.emplace_back(MissedDependency{ lang, it->second, std::nullopt }); // by default prioritizing latest language modules
+			} else {
+				PL_LOG_ERROR("Package: '{}' has language module dependency: '{}', but it was not found.", package->name, lang);
+				result.conflicted = true;
+				continue;
 			}
+		}
 
-			if (const auto& dependencies = pluginDescriptor->dependencies) {
-				for (const auto& dependency : *dependencies) {
-					if (dependency.optional.value_or(false) || !IsSupportsPlatform(dependency.supportedPlatforms))
-						continue;
+		if (const auto& dependencies = pluginDescriptor->dependencies) {
+			for (const auto& dependency : *dependencies) {
+				if (dependency.optional.value_or(false) || !IsSupportsPlatform(dependency.supportedPlatforms))
+					continue;
 
-					if (auto itl = _localPackages.find(dependency.name); itl != _localPackages.end()) {
-						const auto& [_, localPackage] = *itl;
-						if (const auto& version = dependency.requestedVersion) {
-							if (*version != localPackage->version) {
-								PL_LOG_ERROR("Package: '{}' has dependency: '{}' which required (v{}), but (v{}) installed. Conflict cannot be resolved automatically.", package->name, dependency.name, version->to_string(), localPackage->version);
-							}
+				if (auto itl = _localPackages.find(dependency.name); itl != _localPackages.end()) {
+					const auto& [_, localPackage] = *itl;
+					if (const auto& version = dependency.requestedVersion) {
+						if (*version != localPackage->version) {
+							PL_LOG_ERROR("Package: '{}' has dependency: '{}' which required (v{}), but (v{}) installed. Conflict cannot be resolved automatically.", package->name, dependency.name, version->to_string(), localPackage->version);
 						}
-						continue;
 					}
+					continue;
+				}
 
-					if (auto itr = _remotePackages.find(dependency.name); itr != _remotePackages.end()) {
-						const auto& [_, remotePackage] = *itr;
-						if (const auto& version = dependency.requestedVersion) {
-							if (!remotePackage->Version(*version)) {
-								PL_LOG_ERROR("Package: '{}' has dependency: '{}' which required (v{}), but version was not found. Problem cannot be resolved automatically.", package->name, dependency.name, version->to_string());
-								_conflictedPackages.emplace_back(package);
-								continue;
-							}
+				if (auto itr = _remotePackages.find(dependency.name); itr != _remotePackages.end()) {
+					const auto& [_, remotePackage] = *itr;
+					if (const auto& version = dependency.requestedVersion) {
+						if (!remotePackage->Version(*version)) {
+							PL_LOG_ERROR("Package: '{}' has dependency: '{}' which required (v{}), but version was not found. Problem cannot be resolved automatically.", package->name, dependency.name, version->to_string());
+							result.conflicted = true;
+							continue;
 						}
+					}
 
-						auto it = _missedPackages.find(dependency.name);
-						if (it == _missedPackages.end()) {
-							_missedPackages.emplace(dependency.name, std::pair{ remotePackage, dependency.requestedVersion });
-						} else {
-							auto& existingVersion = it->second.second;
-							if (const auto& version = dependency.requestedVersion) {
-								if (*existingVersion != *version) {
-									PL_LOG_WARNING("By default, prioritizing newer version (v{}) of '{}' dependency, over older version (v{}).", std::max(*existingVersion, *version), dependency.name, std::min(*existingVersion, *version));
-
-									if (*existingVersion < *version) {
-										existingVersion = version;
-									}
-								} else {
-									PL_LOG_VERBOSE("The same version (v{}) of dependency '{}' required by '{}' at '{}' - second location will be ignored.", *existingVersion, dependency.name, package->name, package->path.string());
-								}
-							} else {
-								existingVersion = version;
-							}
+					result.missed.emplace_back(MissedDependency{ dependency.name, remotePackage, dependency.requestedVersion });
+				} else {
+					PL_LOG_ERROR("Package: '{}' has dependency: '{}' which could not be found.", package->name, dependency.name);
+					result.conflicted = true;
+				}
+			}
+		}
+	}
+
+	PL_LOG_DEBUG("Dependencies resolved for {} of {} plugin(s)", resolvedCount, _dependencyResults.size());
+
+	// Merging cached results is cheap compared to resolving them
+	_missedPackages.clear();
+	_conflictedPackages.clear();
+
+	for (const auto& [name, result] : _dependencyResults) {
+		if (result.conflicted) {
+			_conflictedPackages.emplace_back(_localPackages.find(name)->second);
+		}
+
+		for (const auto& missed : result.missed) {
+			auto it = _missedPackages.find(missed.name);
+			if (it == _missedPackages.end()) {
+				_missedPackages.emplace(missed.name, std::pair{ missed.package, missed.version });
+			} else {
+				auto& existingVersion = it->second.second;
+				if (const auto& version = missed.version) {
+					if (!existingVersion) {
+						existingVersion = version;
+					} else if (*existingVersion != *version) {
+						PL_LOG_WARNING("By default, prioritizing newer version (v{}) of '{}' dependency, over older version (v{}).", std::max(*existingVersion, *version), missed.name, std::min(*existingVersion, *version));
+
+						if (*existingVersion < *version) {
+							existingVersion = version;
 						}
 					} else {
-						PL_LOG_ERROR("Package: '{}' has dependency: '{}' which could not be found.", package->name, dependency.name);
-						_conflictedPackages.emplace_back(package);
+						PL_LOG_VERBOSE("The same version (v{}) of dependency '{}' required by '{}' - second location will be ignored.", *existingVersion, missed.name, name);
 					}
 				}
 			}
@@ -514,7 +872,7 @@ void PackageManager::Request(F&& action, std::string_view function) {
 
 	_httpDownloader->WaitForAllRequests();
 
-	LoadAllPackages();
+	LoadAllPackages(true);
 
 	PL_LOG_DEBUG("{} processed in {}ms", function, (DateTime::Now() - debugStart).AsMilliseconds<float>());
 }
@@ -933,63 +1291,128 @@ bool PackageManager::DownloadPackage(const PackagePtr& package, const PackageVer
 
 	PL_LOG_INFO("Downloading: '{}'", version.download);
 
-	_httpDownloader->CreateRequest(version.download, [=, checksum = version.checksum]
-		(int32_t statusCode, std::string_view, IHTTPDownloader::Request::Data data) {
-		if (statusCode == IHTTPDownloader::HTTP_STATUS_OK) {
-			PL_LOG_VERBOSE("Done downloading: '{}'", package->name);
+	const auto& [folder, extension] = packageTypes[package->type == "plugin"];
 
-			/*if (contentType != "application/zip") {
-				PL_LOG_ERROR("Package: '{}' should be in *.zip format to be extracted correctly", name);
-				return;
-			}*/
+	fs::path finalPath = plugify->GetConfig().baseDir / folder;
+	fs::path finalLocation = finalPath / std::format("{}-{}", package->name, DateTime::Get("%Y_%m_%d_%H_%M_%S"));
 
-			if (!IsPackageLegit(checksum, data)) {
-				PL_LOG_WARNING("Archive hash '{}' does not match expected checksum, aborting", package->name);
-				return;
+	// Archive is streamed next to the destination, so it never has to be held in memory.
+	// Name is stable between attempts, so a partial archive is resumed by the next download of the same version.
+	fs::path archivePath = finalPath / std::format("{}-{}.zip.part", package->name, version.version);
+
+	{
+		std::error_code ec;
+		fs::create_directories(finalPath, ec);
+	}
+
+	// Checksum is verified by the downloader while the archive is received
+	_httpDownloader->CreateFileRequest(version.download, archivePath, version.checksum, [=, extension = extension]
+		(int32_t statusCode, std::string_view, const fs::path& filePath) {
+		auto removeArchive = [&filePath] {
+			std::error_code ec;
+			fs::remove(filePath, ec);
+		};
+
+		if (statusCode == IHTTPDownloader::HTTP_STATUS_CHECKSUM_MISMATCH) {
+			PL_LOG_WARNING("Archive hash '{}' does not match expected checksum, aborting", package->name);
+			removeArchive();
+			return;
+		}
+
+		if (statusCode != IHTTPDownloader::HTTP_STATUS_OK) {
+			PL_LOG_ERROR("Failed downloading: '{}' - Code: {}", package->name, statusCode);
+			// Partial archive is kept only when the transfer broke off, so the next attempt continues where this one stopped
+			if (statusCode != IHTTPDownloader::HTTP_STATUS_TIMEOUT && statusCode != IHTTPDownloader::HTTP_STATUS_ERROR) {
+				removeArchive();
 			}
+			return;
+		}
 
-			const auto& [folder, extension] = packageTypes[package->type == "plugin"];
+		PL_LOG_VERBOSE("Done downloading: '{}'", package->name);
 
-			fs::path finalPath = plugify->GetConfig().baseDir / folder;
-			fs::path finalLocation = finalPath / std::format("{}-{}", package->name, DateTime::Get("%Y_%m_%d_%H_%M_%S"));
+		/*if (contentType != "application/zip") {
+			PL_LOG_ERROR("Package: '{}' should be in *.zip format to be extracted correctly", name);
+			return;
+		}*/
 
-			std::error_code ec;
-			if (!fs::exists(finalLocation, ec) || !fs::is_directory(finalLocation, ec)) {
-				if (!fs::create_directories(finalLocation, ec)) {
-					PL_LOG_ERROR("Error creating output directory '{}'", finalLocation.string());
-				}
+		std::error_code ec;
+		if (!fs::exists(finalLocation, ec) || !fs::is_directory(finalLocation, ec)) {
+			if (!fs::create_directories(finalLocation, ec)) {
+				PL_LOG_ERROR("Error creating output directory '{}'", finalLocation.string());
 			}
+		}
 
-			auto error = ExtractPackage(data, finalLocation, extension);
-			if (error.empty()) {
-				PL_LOG_VERBOSE("Done extracting: '{}'", package->name);
-				auto destinationPath = finalPath / package->name;
-				ec = FileSystem::MoveFolder(finalLocation, destinationPath);
-				if (ec) {
-					PL_LOG_ERROR("Package: '{}' could be renamed from '{}' to '{}' - {}", package->name, finalLocation.string(), destinationPath.string(), ec.message());
-				} else {
-					PL_LOG_VERBOSE("Package: '{}' was renamed successfully from '{}' to '{}'", package->name, finalLocation.string(), destinationPath.string());
-				}
+		auto error = ExtractPackage(filePath, finalLocation, extension, plugify->GetConfig().workerThreads.value_or(0));
+		removeArchive();
 
+		if (error.empty()) {
+			PL_LOG_VERBOSE("Done extracting: '{}'", package->name);
+			auto destinationPath = finalPath / package->name;
+			ec = FileSystem::MoveFolder(finalLocation, destinationPath);
+			if (ec) {
+				PL_LOG_ERROR("Package: '{}' could be renamed from '{}' to '{}' - {}", package->name, finalLocation.string(), destinationPath.string(), ec.message());
 			} else {
-				PL_LOG_ERROR("Failed extracting: '{}' - {}", package->name, error);
+				PL_LOG_VERBOSE("Package: '{}' was renamed successfully from '{}' to '{}'", package->name, finalLocation.string(), destinationPath.string());
 			}
 		} else {
-			PL_LOG_ERROR("Failed downloading: '{}' - Code: {}", package->name, statusCode);
+			PL_LOG_ERROR("Failed extracting: '{}' - {}", package->name, error);
 		}
 	});
 
 	return true;
 }
 
-std::string PackageManager::ExtractPackage(std::span<const uint8_t> packageData, const fs::path& extractPath, std::string_view descriptorExt) {
+static std::string ExtractFile(mz_zip_archive* zipArchive, const mz_zip_archive_file_stat& fileStat, const fs::path& path, std::span<char> buffer) {
+	auto iterClose = [](mz_zip_reader_extract_iter_state* iterState) { mz_zip_reader_extract_iter_free(iterState); };
+	std::unique_ptr<mz_zip_reader_extract_iter_state, decltype(iterClose)> iterState(mz_zip_reader_extract_iter_new(zipArchive, fileStat.m_file_index, 0), iterClose);
+	if (!iterState) {
+		return std::format("Failed extracting file: '{}'", fileStat.m_filename);
+	}
+
+	// Writes are already done in large chunks, stream buffering would only add a copy
+	std::ofstream outputFile;
+	outputFile.rdbuf()->pubsetbuf(nullptr, 0);
+	outputFile.open(path, std::ios::binary);
+	if (!outputFile.is_open()) {
+		return std::format("Failed creating destination file: '{}'", fileStat.m_filename);
+	}
+
+	uint64_t written = 0;
+	while (written < fileStat.m_uncomp_size) {
+		size_t read = mz_zip_reader_extract_iter_read(iterState.get(), buffer.data(), buffer.size());
+		if (read == 0)
+			break;
+
+		outputFile.write(buffer.data(), static_cast<std::streamsize>(read));
+		written += read;
+	}
+
+	// Freeing the iterator validates CRC of the whole entry
+	if (!mz_zip_reader_extract_iter_free(iterState.release()) || written != fileStat.m_uncomp_size || !outputFile) {
+		return std::format("Failed extracting file: '{}'", fileStat.m_filename);
+	}
+
+	return {};
+}
+
+std::string PackageManager::ExtractPackage(const fs::path& packagePath, const fs::path& extractPath, std::string_view descriptorExt, size_t threadCount) {
 	PL_LOG_VERBOSE("Start extracting: '{}' ....", extractPath.string());
 
 	auto zipClose = [](mz_zip_archive* zipArchive){ mz_zip_reader_end(zipArchive); delete zipArchive; };
-	std::unique_ptr<mz_zip_archive, decltype(zipClose)> zipArchive(new mz_zip_archive, zipClose);
-	std::memset(zipArchive.get(), 0, sizeof(mz_zip_archive));
+	using ZipArchivePtr = std::unique_ptr<mz_zip_archive, decltype(zipClose)>;
+
+	auto zipOpen = [&]() -> ZipArchivePtr {
+		ZipArchivePtr zipArchive(new mz_zip_archive, zipClose);
+		std::memset(zipArchive.get(), 0, sizeof(mz_zip_archive));
+		if (!mz_zip_reader_init_file(zipArchive.get(), packagePath.string().c_str(), 0))
+			return ZipArchivePtr(nullptr, zipClose);
+		return zipArchive;
+	};
 
-	mz_zip_reader_init_mem(zipArchive.get(), packageData.data(), packageData.size(), 0);
+	auto zipArchive = zipOpen();
+	if (!zipArchive) {
+		return "Failed reading archive";
+	}
 
 	//state.total = zipArchive->m_archive_size;
 	//state.progress = 0;
@@ -1016,50 +1439,90 @@ std::string PackageManager::ExtractPackage(std::span<const uint8_t> packageData,
 		return std::format("Package descriptor *{} missing", descriptorExt);
 	}
 
-	for (uint32_t i = 0; i < numFiles; ++i) {
-		mz_zip_archive_file_stat& fileStat = fileStats[i];
+	// Directories are created up front, so workers only ever write files
+	std::unordered_set<fs::path, path_hash> directories;
+	std::vector<const mz_zip_archive_file_stat*> files;
+	files.reserve(numFiles);
 
-		std::vector<char> fileData(static_cast<size_t>(fileStat.m_uncomp_size));
-
-		if (!mz_zip_reader_extract_to_mem(zipArchive.get(), i, fileData.data(), fileData.size(), 0)) {
-			return std::format("Failed extracting file: '{}'", fileStat.m_filename);
+	for (const auto& fileStat : fileStats) {
+		fs::path finalPath = extractPath / fileStat.m_filename;
+		if (fileStat.m_is_directory) {
+			directories.emplace(std::move(finalPath));
+		} else {
+			directories.emplace(finalPath.parent_path());
+			files.emplace_back(&fileStat);
 		}
+	}
 
+	for (const auto& directory : directories) {
 		std::error_code ec;
-		fs::path finalPath = extractPath / fileStat.m_filename;
+		fs::create_directories(directory, ec);
+	}
 
-		if (fileStat.m_is_directory) {
-			fs::create_directories(finalPath, ec);
-		} else {
-			fs::create_directories(finalPath.parent_path(), ec);
+	// Biggest entries go first to balance the work between threads
+	std::sort(files.begin(), files.end(), [](const mz_zip_archive_file_stat* lhs, const mz_zip_archive_file_stat* rhs) {
+		return lhs->m_uncomp_size > rhs->m_uncomp_size;
+	});
 
-			std::ofstream outputFile(finalPath, std::ios::binary);
-			if (outputFile.is_open()) {
-				outputFile.write(fileData.data(), static_cast<std::streamsize>(fileData.size()));
-			} else {
-				return std::format("Failed creating destination file: '{}'", fileStat.m_filename);
-			}
+	if (threadCount == 0) {
+		threadCount = ThreadPool::GetDefaultThreadCount();
+	}
+	threadCount = std::min(threadCount, files.size());
+
+	if (threadCount <= 1) {
+		// Entries are inflated into one reusable buffer, so memory usage does not depend on the entry size
+		std::vector<char> buffer(kExtractBufferSize);
+
+		for (const auto* fileStat : files) {
+			auto error = ExtractFile(zipArchive.get(), *fileStat, extractPath / fileStat->m_filename, buffer);
+			if (!error.empty())
+				return error;
 
 			//state.progress += fileStat.m_comp_size;
 			//state.ratio = std::roundf(static_cast<float>(_packageState.progress) / static_cast<float>(_packageState.total) * 100.0f);
 		}
+
+		return {};
 	}
 
-	return {};
-}
+	std::atomic<size_t> next{ 0 };
+	std::mutex mutex;
+	std::string firstError;
+
+	auto worker = [&] {
+		// Reader state is not thread safe, so every worker opens the archive on its own
+		auto workerArchive = zipOpen();
+		if (!workerArchive) {
+			std::unique_lock<std::mutex> lock(mutex);
+			if (firstError.empty()) {
+				firstError = "Failed reading archive";
+			}
+			return;
+		}
 
-bool PackageManager::IsPackageLegit(std::string_view checksum, std::span<const uint8_t> packageData) {
-	if (checksum.empty())
-		return true;
+		std::vector<char> buffer(kExtractBufferSize);
 
-	Sha256 sha;
-	sha.update(packageData);
-	std::string hash(Sha256::ToString(sha.digest()));
+		for (size_t i = next++; i < files.size(); i = next++) {
+			const auto* fileStat = files[i];
+			auto error = ExtractFile(workerArchive.get(), *fileStat, extractPath / fileStat->m_filename, buffer);
+			if (!error.empty()) {
+				std::unique_lock<std::mutex> lock(mutex);
+				if (firstError.empty()) {
+					firstError = std::move(error);
+				}
+				next = files.size();
+				return;
+			}
+		}
+	};
 
-	PL_LOG_VERBOSE("Expected checksum: {}", checksum);
-	PL_LOG_VERBOSE("Computed checksum: {}", hash);
+	ThreadPool pool(threadCount);
+	for (size_t i = 0; i < threadCount; ++i) {
+		pool.Enqueue(worker);
+	}
+	pool.Wait();
 
-	return checksum == hash;
+	return firstError;
 }
 
 #else
@@ -7,8 +7,10 @@
 #include <utils/hash.hpp>
 
 namespace plugify {
+	class DescriptorCache;
 #if PLUGIFY_DOWNLOADER
 	class IHTTPDownloader;
+	class ManifestCache;
 #endif // PLUGIFY_DOWNLOADER
 	class PackageManager final : public IPackageManager, public PlugifyContext {
 	public:
@@ -21,6 +23,7 @@ namespace plugify {
 		void Terminate() override;
 		bool IsInitialized() const override;
 		bool Reload() override;
+		LocalPackagePtr ReloadLocalPackage(std::string_view packageName) override;
 
 		void InstallPackage(std::string_view packageName, std::optional<plg::version> requiredVersion) override;
 		void InstallPackages(std::span<const std::string> packageNames) override;
@@ -49,16 +52,26 @@ namespace plugify {
 		std::vector<RemotePackagePtr> GetRemotePackages() const override;
 
 	public:
+		using NameSet = std::unordered_set<std::string, string_hash, std::equal_to<>>;
+
+#if PLUGIFY_DOWNLOADER
+		// Manifest requests avoided by URL coalescing and the manifest cache since initialization
+		size_t GetSavedRoundTrips() const noexcept {
+			return _savedRoundTrips;
+		}
+#endif // PLUGIFY_DOWNLOADER
+
 		static bool IsSupportsPlatform(const std::optional<std::vector<std::string>>& supportedPlatforms) {
 			return !supportedPlatforms.has_value() || supportedPlatforms->empty() || std::find(supportedPlatforms->begin(), supportedPlatforms->end(), PLUGIFY_PLATFORM) != supportedPlatforms->end();
 		}
 
 	private:
-		void LoadAllPackages();
-		void LoadLocalPackages();
+		// Incremental load reuses the results of the previous one for everything which is not changed
+		void LoadAllPackages(bool incremental);
+		NameSet LoadLocalPackages();
 #if PLUGIFY_DOWNLOADER
-		void LoadRemotePackages();
-		void FindDependencies();
+		void LoadRemotePackages(NameSet* changed = nullptr);
+		void FindDependencies(const NameSet* changed = nullptr);
 
 		template<typename F>
 		void Request(F&& action, std::string_view function);
@@ -67,18 +80,44 @@ namespace plugify {
 		bool InstallPackage(const RemotePackagePtr& package, std::optional<plg::version> requiredVersion = {});
 		bool UninstallPackage(const LocalPackagePtr& package, bool remove = true);
 		bool DownloadPackage(const PackagePtr& package, const PackageVersion& version) const;
-		static std::string ExtractPackage(std::span<const uint8_t> packageData, const fs::path& extractPath, std::string_view descriptorExt);
-		static bool IsPackageLegit(std::string_view checksum, std::span<const uint8_t> packageData);
+		static inline size_t kExtractBufferSize = 1 << 20;
+		static std::string ExtractPackage(const fs::path& packagePath, const fs::path& extractPath, std::string_view descriptorExt, size_t threadCount);
+#endif // PLUGIFY_DOWNLOADER
+
+	private:
+		struct LocalFile {
+			std::string name;
+			int64_t lastWriteTime;
+			uint64_t fileSize;
+			LocalPackagePtr package;
+		};
+
+#if PLUGIFY_DOWNLOADER
+		struct MissedDependency {
+			std::string name;
+			RemotePackagePtr package;
+			std::optional<plg::version> version;
+		};
+
+		struct DependencyResult {
+			std::vector<MissedDependency> missed;
+			bool conflicted{};
+		};
 #endif // PLUGIFY_DOWNLOADER
 
 	private:
 #if PLUGIFY_DOWNLOADER
 		std::unique_ptr<IHTTPDownloader> _httpDownloader;
+		std::unique_ptr<ManifestCache> _manifestCache;
+		size_t _savedRoundTrips{ 0 };
+		std::unordered_map<std::string, DependencyResult, string_hash, std::equal_to<>> _dependencyResults;
 #endif // PLUGIFY_DOWNLOADER
+		std::unique_ptr<DescriptorCache> _descriptorCache;
 		std::unordered_map<std::string, LocalPackagePtr, string_hash, std::equal_to<>> _localPackages;
 		std::unordered_map<std::string, RemotePackagePtr, string_hash, std::equal_to<>> _remotePackages;
 		std::unordered_map<std::string, std::pair<RemotePackagePtr, std::optional<plg::version>>> _missedPackages;
 		std::vector<LocalPackagePtr> _conflictedPackages;
+		std::unordered_map<std::string, LocalFile, string_hash, std::equal_to<>> _localFiles;
 		bool _inited{ false };
 	};
 }
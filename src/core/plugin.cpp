@@ -71,6 +71,8 @@ Plugin& Plugin::operator=(Plugin&& other) noexcept {
 	_table = other._table;
 	_id = other._id;
 	_data = other._data;
+	_updateCost = other._updateCost;
+	_hasUpdateSample = other._hasUpdateSample;
 
 	_name = std::move(other._name);
 	_baseDir = std::move(other._baseDir);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "plugin_descriptor.hpp"
+#include "update_cost.hpp"
 #include <plugify/plugin.hpp>
 #include <plugify/date_time.hpp>
 #include <utils/hash.hpp>
@@ -110,6 +111,20 @@ namespace plugify {
 			return _table.hasExport;
 		}
 
+		uint32_t GetUpdateDivisor() const noexcept {
+			return _descriptor->updateDivisor.value_or(1);
+		}
+
+		DateTime GetUpdateCost() const noexcept {
+			return _updateCost;
+		}
+
+		// Exponentially weighted moving average of the update cost, the first sample is taken as is
+		void AddUpdateSample(DateTime cost) noexcept {
+			_updateCost = _hasUpdateSample ? _updateCost + (cost - _updateCost) * kUpdateCostFactor : cost;
+			_hasUpdateSample = true;
+		}
+
 		bool Initialize(const std::shared_ptr<IPlugifyProvider>& provider);
 		void Terminate();
 
@@ -124,6 +139,8 @@ namespace plugify {
 		MethodTable _table;
 		UniqueId _id;
 		MemAddr _data;
+		DateTime _updateCost;
+		bool _hasUpdateSample{ false };
 		std::string _name;
 		fs::path _baseDir;
 		std::vector<MethodData> _methods;
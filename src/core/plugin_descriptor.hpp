@@ -12,6 +12,7 @@ namespace plugify {
 	struct PluginDescriptor : public Descriptor {
 		std::string entryPoint;
 		LanguageModuleInfo languageModule;
+		std::optional<uint32_t> updateDivisor;
 		std::optional<std::vector<PluginReferenceDescriptor>> dependencies;
 		std::optional<std::vector<Method>> exportedMethods;
 
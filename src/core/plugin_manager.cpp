@@ -8,6 +8,7 @@
 #include <plugify/plugin_manager.hpp>
 #include <plugify/plugin_reference_descriptor.hpp>
 #include <utils/json.hpp>
+#include <utils/thread_pool.hpp>
 
 using namespace plugify;
 
@@ -25,8 +26,16 @@ bool PluginManager::Initialize() {
 	auto debugStart = DateTime::Now();
 
 	DiscoverAllModulesAndPlugins();
+	BuildLookupTables();
 	LoadRequiredLanguageModules();
 	LoadAndStartAvailablePlugins();
+	WatchPlugins();
+
+	if (auto plugify = _plugify.lock()) {
+		_updateBudget = DateTime(std::chrono::duration<double, std::milli>(plugify->GetConfig().updateBudget.value_or(0.0)));
+	}
+	_updateTick = 0;
+	_updateListDirty = true;
 
 	_inited = true;
 
@@ -38,9 +47,23 @@ void PluginManager::Terminate() {
 	if (!IsInitialized())
 		return;
 
+	_fileWatcher.reset();
+	_watchedFiles.clear();
+	_pendingReloads.clear();
+	_updatePool.reset();
+	_updateGroups.clear();
+	_updateList.clear();
+
 	TerminateAllPlugins();
 	TerminateAllModules();
 
+	_pluginNameIndex.clear();
+	_pluginIdIndex.clear();
+	_moduleNameIndex.clear();
+	_moduleLangIndex.clear();
+	_moduleIdIndex.clear();
+	_modulePathIndex.clear();
+
 	_inited = false;
 }
 
@@ -52,15 +75,340 @@ void PluginManager::Update(DateTime dt) {
 	if (!IsInitialized())
 		return;
 
+	if (_updateListDirty) {
+		BuildUpdateList();
+	}
+
+	auto tick = _updateTick++;
+	auto frameStart = DateTime::Now();
+
+	// Every module which allows parallel update is ticked together with its plugins as one task
+	for (size_t i = 1; i < _updateGroups.size(); ++i) {
+		auto& group = _updateGroups[i];
+		_updatePool->Enqueue(group.worker, [this, &group, dt, tick, frameStart] {
+			auto start = DateTime::Now();
+			group.module->Update(dt);
+			group.module->AddUpdateTime(DateTime::Now() - start);
+			UpdatePlugins(group, dt, tick, frameStart);
+		});
+	}
+
 	for (auto& module : _allModules) {
+		if (module.HasParallelUpdate() && module.GetState() == ModuleState::Loaded)
+			continue;
+
+		auto start = DateTime::Now();
 		module.Update(dt);
+		module.AddUpdateTime(DateTime::Now() - start);
 	}
 
-	for (auto& plugin : _allPlugins) {
-		if (plugin.GetState() == PluginState::Loaded) {
-			plugin.GetModule()->UpdatePlugin(plugin, dt);
+	if (!_updateGroups.empty()) {
+		UpdatePlugins(_updateGroups.front(), dt, tick, frameStart);
+	}
+
+	if (_updatePool) {
+		_updatePool->Wait();
+	}
+
+	for (auto& module : _allModules) {
+		module.CommitUpdateTime();
+	}
+
+	if (_fileWatcher) {
+		ProcessHotReload();
+	}
+}
+
+void PluginManager::BuildUpdateList() {
+	_updateList.clear();
+	_updateGroups.clear();
+	_updateListDirty = false;
+
+	auto addPlugins = [this](const Module* parallelModule) {
+		for (size_t i = 0; i < _allPlugins.size(); ++i) {
+			auto& plugin = _allPlugins[i];
+			if (plugin.GetState() != PluginState::Running || !plugin.HasUpdate())
+				continue;
+
+			auto* module = plugin.GetModule();
+			if (module->GetState() != ModuleState::Loaded)
+				continue;
+
+			if (parallelModule ? module != parallelModule : module->HasParallelUpdate())
+				continue;
+
+			_updateList.emplace_back(UpdateEntry{ module, module->GetLanguageModule(), &plugin, plugin.GetUpdateDivisor(), static_cast<uint32_t>(i), {}, false });
+		}
+	};
+
+	// First group is updated on the caller thread and keeps the load order of plugins
+	auto& sequential = _updateGroups.emplace_back();
+	addPlugins(nullptr);
+	sequential.end = _updateList.size();
+
+	size_t worker = 0;
+	for (auto& module : _allModules) {
+		if (module.GetState() != ModuleState::Loaded || !module.HasParallelUpdate())
+			continue;
+
+		UpdateGroup group{ &module, _updateList.size() };
+		addPlugins(&module);
+		group.end = _updateList.size();
+		group.worker = worker++;
+		_updateGroups.push_back(group);
+	}
+
+	if (worker == 0) {
+		_updatePool.reset();
+	} else if (!_updatePool) {
+		auto plugify = _plugify.lock();
+		PL_ASSERT(plugify);
+
+		size_t threadCount = plugify->GetConfig().workerThreads.value_or(0);
+		if (threadCount == 0) {
+			threadCount = ThreadPool::GetDefaultThreadCount();
+		}
+		// Worker index of the group is stable, so a module is always ticked by the same thread
+		_updatePool = std::make_unique<ThreadPool>(std::min(threadCount, worker));
+	}
+}
+
+void PluginManager::UpdatePlugins(UpdateGroup& group, DateTime dt, uint64_t tick, DateTime frameStart) {
+	const size_t count = group.end - group.begin;
+	if (count == 0)
+		return;
+
+	bool overBudget = false;
+	std::optional<size_t> firstDeferred;
+
+	for (size_t n = 0; n < count; ++n) {
+		size_t i = group.begin + (group.cursor + n) % count;
+		auto& entry = _updateList[i];
+		// Host delta of skipped and deferred ticks is handed over on the next update
+		entry.elapsed += dt;
+
+		// Phase keeps plugins with the same divisor from landing on the same tick
+		if (!entry.deferred && (tick + entry.phase) % entry.divisor != 0)
+			continue;
+
+		if (overBudget) {
+			entry.deferred = true;
+			if (!firstDeferred) {
+				firstDeferred = i - group.begin;
+			}
+			continue;
+		}
+
+		auto& plugin = *entry.plugin;
+		auto start = DateTime::Now();
+		entry.languageModule->OnPluginUpdate(plugin, entry.elapsed);
+		auto end = DateTime::Now();
+		plugin.AddUpdateSample(end - start);
+		entry.module->AddUpdateTime(end - start);
+		entry.elapsed = {};
+		entry.deferred = false;
+
+		if (_updateBudget > DateTime{} && end - frameStart >= _updateBudget) {
+			overBudget = true;
+		}
+	}
+
+	// Deferred plugins get the first chance on the next tick
+	if (firstDeferred) {
+		group.cursor = *firstDeferred;
+	}
+}
+
+bool PluginManager::ReloadPlugin(std::string_view pluginName) {
+	if (!IsInitialized())
+		return false;
+
+	auto it = _pluginNameIndex.find(pluginName);
+	if (it == _pluginNameIndex.end())
+		return false;
+
+	auto plugify = _plugify.lock();
+	PL_ASSERT(plugify);
+	auto provider = plugify->GetProvider().lock();
+	PL_ASSERT(provider);
+
+	auto debugStart = DateTime::Now();
+
+	// Plugin object is replaced below, so keep own copy of the name
+	std::string name(pluginName);
+	size_t index = std::get<size_t>(*it);
+	auto affected = GetDependentPlugins(index);
+
+	for (auto i = affected.rbegin(); i != affected.rend(); ++i) {
+		auto& plugin = _allPlugins[*i];
+		if (plugin.GetState() == PluginState::Running) {
+			plugin.GetModule()->EndPlugin(plugin);
+		}
+		plugin.Terminate();
+	}
+
+	// Only the descriptor of this plugin is read again, nothing is fetched from the network
+	LocalPackagePtr package;
+	if (auto packageManager = plugify->GetPackageManager().lock()) {
+		package = packageManager->ReloadLocalPackage(name);
+	}
+
+	auto& plugin = _allPlugins[index];
+	if (!package || package->type != "plugin") {
+		plugin.SetError("Package was removed");
+	} else {
+		plugin = Plugin(plugin.GetId(), *package);
+		plugin.Initialize(provider);
+
+		const auto& lang = plugin.GetDescriptor().languageModule.name;
+		auto itm = _moduleLangIndex.find(lang);
+		if (itm == _moduleLangIndex.end()) {
+			plugin.SetError(std::format("Language module: '{}' missing for plugin: '{}'", lang, plugin.GetFriendlyName()));
+		} else {
+			plugin.SetModule(_allModules[std::get<size_t>(*itm)]);
+		}
+
+		// Load order was fixed at startup, a new dependency on a later plugin requires a full restart
+		if (const auto& dependencies = plugin.GetDescriptor().dependencies) {
+			for (const auto& dependency : *dependencies) {
+				auto itd = _pluginNameIndex.find(dependency.name);
+				if (itd != _pluginNameIndex.end() && std::get<size_t>(*itd) >= index) {
+					plugin.SetError(std::format("Dependency: '{}' is loaded after plugin, restart plugin manager to apply", dependency.name));
+					break;
+				}
+			}
+		}
+	}
+
+	for (size_t i : affected) {
+		LoadPlugin(_allPlugins[i]);
+	}
+
+	for (size_t i : affected) {
+		ExportPlugin(_allPlugins[i]);
+	}
+
+	for (size_t i : affected) {
+		auto& affectedPlugin = _allPlugins[i];
+		if (affectedPlugin.GetState() == PluginState::Loaded) {
+			affectedPlugin.GetModule()->StartPlugin(affectedPlugin);
+		}
+	}
+
+	_updateListDirty = true;
+
+	// Entry point could be changed by the new descriptor
+	if (_fileWatcher) {
+		WatchPlugin(index);
+	}
+
+	PL_LOG_DEBUG("Plugin '{}' reloaded with {} dependent plugin(s) in {}ms", name, affected.size() - 1, (DateTime::Now() - debugStart).AsMilliseconds<float>());
+	return _allPlugins[index].GetState() == PluginState::Running;
+}
+
+std::vector<size_t> PluginManager::GetDependentPlugins(size_t index) const {
+	// Plugins are sorted, so dependents are always placed after the plugin they depend on
+	std::vector<size_t> dependents{ index };
+	std::unordered_set<std::string_view> names{ _allPlugins[index].GetName() };
+
+	for (size_t i = index + 1; i < _allPlugins.size(); ++i) {
+		const auto& plugin = _allPlugins[i];
+		if (const auto& dependencies = plugin.GetDescriptor().dependencies) {
+			for (const auto& dependency : *dependencies) {
+				if (names.contains(dependency.name)) {
+					dependents.push_back(i);
+					names.emplace(plugin.GetName());
+					break;
+				}
+			}
+		}
+	}
+
+	return dependents;
+}
+
+void PluginManager::WatchPlugins() {
+	auto plugify = _plugify.lock();
+	PL_ASSERT(plugify);
+
+	if (!plugify->GetConfig().hotReload.value_or(false) || _allPlugins.empty())
+		return;
+
+	_fileWatcher = IFileWatcher::Create();
+	if (!_fileWatcher) {
+		PL_LOG_WARNING("Could not create file watcher, hot reload is disabled");
+		return;
+	}
+
+	for (size_t i = 0; i < _allPlugins.size(); ++i) {
+		WatchPlugin(i);
+	}
+}
+
+// Descriptor and binary of the plugin, other files in its directory are often written by the plugin itself
+static std::vector<fs::path> GetPluginFiles(const Plugin& plugin) {
+	const auto& baseDir = plugin.GetBaseDir();
+	std::vector<fs::path> files{ baseDir / (plugin.GetName() + std::string(Plugin::kFileExtension)) };
+
+	const auto& entryPoint = plugin.GetDescriptor().entryPoint;
+	if (entryPoint.empty())
+		return files;
+
+	// Entry point is interpreted by the language module, native ones add the platform prefix and suffix
+	fs::path entryPath = baseDir / entryPoint;
+	fs::path libraryPath = entryPath.parent_path() / std::format(PLUGIFY_LIBRARY_PREFIX "{}" PLUGIFY_LIBRARY_SUFFIX, entryPath.filename().string());
+
+	std::error_code ec;
+	for (const auto& path : { entryPath, libraryPath }) {
+		if (fs::is_regular_file(path, ec)) {
+			files.push_back(path);
+		}
+	}
+	return files;
+}
+
+void PluginManager::WatchPlugin(size_t index) {
+	std::erase_if(_watchedFiles, [&](const auto& entry) {
+		const auto& [file, plugin] = entry;
+		if (plugin != index)
+			return false;
+		_fileWatcher->Unwatch(file);
+		return true;
+	});
+
+	for (auto& file : GetPluginFiles(_allPlugins[index])) {
+		if (_fileWatcher->Watch(file)) {
+			_watchedFiles.insert_or_assign(std::move(file), index);
+		}
+	}
+}
+
+void PluginManager::ProcessHotReload() {
+	auto now = DateTime::Now();
+
+	for (const auto& file : _fileWatcher->Poll()) {
+		auto it = _watchedFiles.find(file);
+		if (it != _watchedFiles.end()) {
+			_pendingReloads.insert_or_assign(it->second, now);
 		}
 	}
+
+	// Files are usually written in several steps, so wait until the plugin files settle down
+	constexpr auto kSettleTime = 250ms;
+
+	for (auto it = _pendingReloads.begin(); it != _pendingReloads.end();) {
+		const auto& [index, time] = *it;
+		if (now - time < DateTime(kSettleTime)) {
+			++it;
+			continue;
+		}
+
+		std::string name = _allPlugins[index].GetName();
+		PL_LOG_INFO("Plugin '{}' was changed on disk, reloading", name);
+		ReloadPlugin(name);
+
+		it = _pendingReloads.erase(it);
+	}
 }
 
 void PluginManager::DiscoverAllModulesAndPlugins() {
@@ -100,24 +448,51 @@ void PluginManager::DiscoverAllModulesAndPlugins() {
 		return;
 	}
 
-	PluginList sortedPlugins;
-	sortedPlugins.reserve(_allPlugins.size());
-	while (!_allPlugins.empty()) {
-		SortPluginsByDependencies(_allPlugins.back().GetName(), _allPlugins, sortedPlugins);
-	}
-
-	if (HasCyclicDependencies(sortedPlugins)) {
-		PL_LOG_WARNING("Found cyclic dependencies");
+	auto cycles = SortPluginsByDependencies(_allPlugins);
+	for (const auto& cycle : cycles) {
+		std::string names;
+		bool first = true;
+		for (const auto& name : cycle) {
+			if (first) {
+				std::format_to(std::back_inserter(names), "'{}", name);
+				first = false;
+			} else {
+				std::format_to(std::back_inserter(names), "', '{}", name);
+			}
+		}
+		names += '\'';
+		PL_LOG_WARNING("Found cyclic dependencies between {} plugin(s)", names);
 	}
 
-	_allPlugins = std::move(sortedPlugins);
-
 	PL_LOG_VERBOSE("Plugins order after topological sorting by dependency: ");
 	for (const auto& plugin : _allPlugins) {
 		PL_LOG_VERBOSE("{} - {}", plugin.GetName(), plugin.GetFriendlyName());
 	}
 }
 
+void PluginManager::BuildLookupTables() {
+	// Lists are not modified after sorting, so indices stay valid until termination
+	_pluginNameIndex.reserve(_allPlugins.size());
+	_pluginIdIndex.reserve(_allPlugins.size());
+	for (size_t i = 0; i < _allPlugins.size(); ++i) {
+		const auto& plugin = _allPlugins[i];
+		_pluginNameIndex.try_emplace(plugin.GetName(), i);
+		_pluginIdIndex.try_emplace(plugin.GetId(), i);
+	}
+
+	_moduleNameIndex.reserve(_allModules.size());
+	_moduleLangIndex.reserve(_allModules.size());
+	_moduleIdIndex.reserve(_allModules.size());
+	_modulePathIndex.reserve(_allModules.size());
+	for (size_t i = 0; i < _allModules.size(); ++i) {
+		const auto& module = _allModules[i];
+		_moduleNameIndex.try_emplace(module.GetName(), i);
+		_moduleLangIndex.try_emplace(module.GetLanguage(), i);
+		_moduleIdIndex.try_emplace(module.GetId(), i);
+		_modulePathIndex.try_emplace(module.GetFilePath(), i);
+	}
+}
+
 void PluginManager::LoadRequiredLanguageModules() {
 	if (_allModules.empty())
 		return;
@@ -132,14 +507,12 @@ void PluginManager::LoadRequiredLanguageModules() {
 
 	for (auto& plugin : _allPlugins) {
 		const auto& lang = plugin.GetDescriptor().languageModule.name;
-		auto it = std::find_if(_allModules.begin(), _allModules.end(), [&lang](const auto& p) {
-			return p.GetLanguage() == lang;
-		});
-		if (it == _allModules.end()) {
+		auto it = _moduleLangIndex.find(lang);
+		if (it == _moduleLangIndex.end()) {
 			plugin.SetError(std::format("Language module: '{}' missing for plugin: '{}'", lang, plugin.GetFriendlyName()));
 			continue;
 		}
-		auto& module = *it;
+		auto& module = _allModules[std::get<size_t>(*it)];
 		plugin.Initialize(provider);
 		plugin.SetModule(module);
 		modules.emplace(module.GetId());
@@ -162,41 +535,19 @@ void PluginManager::LoadRequiredLanguageModules() {
 void PluginManager::LoadAndStartAvailablePlugins() {
 	if (_allPlugins.empty())
 		return;
+
+	auto plugify = _plugify.lock();
+	PL_ASSERT(plugify);
+
+	if (plugify->GetConfig().parallelStartup.value_or(false)) {
+		LoadAndStartAvailablePluginsParallel();
+		return;
+	}
 	
 	bool loadedAny = false;
 	
 	for (auto& plugin : _allPlugins) {
-		if (plugin.GetState() == PluginState::NotLoaded) {
-			if (plugin.GetModule()->GetState() != ModuleState::Loaded) {
-				plugin.SetError(std::format("Language module: '{}' missing", plugin.GetModule()->GetFriendlyName()));
-				continue;
-			}
-			std::vector<std::string_view> names;
-			if (const auto& dependencies = plugin.GetDescriptor().dependencies) {
-				for (const auto& dependency: *dependencies) {
-					auto dependencyPlugin = FindPlugin(dependency.name);
-					if ((!dependencyPlugin || dependencyPlugin.GetState() != PluginState::Loaded) && !dependency.optional.value_or(false)) {
-						names.emplace_back(dependency.name);
-					}
-				}
-			}
-			if (!names.empty()) {
-				std::string error;
-				bool first = true;
-				for (const auto& name : names) {
-					if (first) {
-						std::format_to(std::back_inserter(error), "'{}", name);
-						first = false;
-					} else {
-						std::format_to(std::back_inserter(error), "', '{}", name);
-					}
-				}
-				error += '\'';
-				plugin.SetError(std::format("Not loaded {} dependency plugin(s)", error));
-			} else {
-				loadedAny |= plugin.GetModule()->LoadPlugin(plugin);
-			}
-		}
+		loadedAny |= LoadPlugin(plugin);
 	}
 	
 	if (!loadedAny) {
@@ -204,19 +555,149 @@ void PluginManager::LoadAndStartAvailablePlugins() {
 		return;
 	}
 
+	for (auto& plugin : _allPlugins) {
+		ExportPlugin(plugin);
+	}
+
 	for (auto& plugin : _allPlugins) {
 		if (plugin.GetState() == PluginState::Loaded) {
-			for (const auto& module : _allModules) {
-				module.MethodExport(plugin);
+			plugin.GetModule()->StartPlugin(plugin);
+		}
+	}
+}
+
+void PluginManager::LoadAndStartAvailablePluginsParallel() {
+	auto plugify = _plugify.lock();
+	PL_ASSERT(plugify);
+
+	auto levels = GetPluginLevels();
+
+	ThreadPool pool(plugify->GetConfig().workerThreads.value_or(0));
+
+	// Plugins of language modules which do not allow parallel load are processed on the caller thread
+	auto runLevel = [&pool](std::span<Plugin* const> level, const auto& action) {
+		for (auto* plugin : level) {
+			auto* module = plugin->GetModule();
+			if (module && module->HasParallelLoad()) {
+				pool.Enqueue([plugin, &action] { action(*plugin); });
+			} else {
+				action(*plugin);
 			}
 		}
+		pool.Wait();
+	};
+
+	std::atomic_bool loadedAny = false;
+
+	for (size_t i = 0; i < levels.size(); ++i) {
+		const auto& level = levels[i];
+
+		auto debugStart = DateTime::Now();
+
+		runLevel(level, [this, &loadedAny](Plugin& plugin) {
+			if (LoadPlugin(plugin)) {
+				loadedAny.store(true, std::memory_order_relaxed);
+			}
+		});
+
+		for (auto* plugin : level) {
+			ExportPlugin(*plugin);
+		}
+
+		runLevel(level, [](Plugin& plugin) {
+			if (plugin.GetState() == PluginState::Loaded) {
+				plugin.GetModule()->StartPlugin(plugin);
+			}
+		});
+
+		PL_LOG_DEBUG("Plugins level {} ({} plugin(s)) loaded in {}ms", i, level.size(), (DateTime::Now() - debugStart).AsMilliseconds<float>());
+	}
+
+	if (!loadedAny) {
+		PL_LOG_WARNING("Did not load any plugin");
 	}
+}
+
+bool PluginManager::LoadPlugin(Plugin& plugin) const {
+	if (plugin.GetState() != PluginState::NotLoaded)
+		return false;
+
+	auto* module = plugin.GetModule();
+	if (!module) {
+		plugin.SetError(std::format("Language module: '{}' missing", plugin.GetDescriptor().languageModule.name));
+		return false;
+	}
+
+	if (module->GetState() != ModuleState::Loaded) {
+		plugin.SetError(std::format("Language module: '{}' missing", module->GetFriendlyName()));
+		return false;
+	}
+
+	std::vector<std::string_view> names;
+	if (const auto& dependencies = plugin.GetDescriptor().dependencies) {
+		for (const auto& dependency: *dependencies) {
+			auto dependencyPlugin = FindPlugin(dependency.name);
+			if ((!dependencyPlugin || (dependencyPlugin.GetState() != PluginState::Loaded && dependencyPlugin.GetState() != PluginState::Running)) && !dependency.optional.value_or(false)) {
+				names.emplace_back(dependency.name);
+			}
+		}
+	}
+
+	if (!names.empty()) {
+		std::string error;
+		bool first = true;
+		for (const auto& name : names) {
+			if (first) {
+				std::format_to(std::back_inserter(error), "'{}", name);
+				first = false;
+			} else {
+				std::format_to(std::back_inserter(error), "', '{}", name);
+			}
+		}
+		error += '\'';
+		plugin.SetError(std::format("Not loaded {} dependency plugin(s)", error));
+		return false;
+	}
+
+	return module->LoadPlugin(plugin);
+}
+
+void PluginManager::ExportPlugin(Plugin& plugin) const {
+	if (plugin.GetState() != PluginState::Loaded)
+		return;
+
+	for (const auto& module : _allModules) {
+		module.MethodExport(plugin);
+	}
+}
+
+std::vector<std::vector<Plugin*>> PluginManager::GetPluginLevels() {
+	// Plugins are already sorted, so every dependency has the level assigned before its dependents
+	std::unordered_map<std::string_view, size_t> pluginLevels;
+	pluginLevels.reserve(_allPlugins.size());
+
+	std::vector<std::vector<Plugin*>> levels;
 
 	for (auto& plugin : _allPlugins) {
-		if (plugin.GetState() == PluginState::Loaded) {
-			plugin.GetModule()->StartPlugin(plugin);
+		size_t level = 0;
+		if (const auto& dependencies = plugin.GetDescriptor().dependencies) {
+			for (const auto& dependency : *dependencies) {
+				auto it = pluginLevels.find(dependency.name);
+				if (it != pluginLevels.end()) {
+					level = std::max(level, std::get<size_t>(*it) + 1);
+				}
+			}
 		}
+
+		pluginLevels.emplace(plugin.GetName(), level);
+
+		if (level >= levels.size()) {
+			levels.resize(level + 1);
+		}
+		levels[level].emplace_back(&plugin);
 	}
+
+	return levels;
 }
 
 void PluginManager::TerminateAllPlugins() {
@@ -250,103 +731,140 @@ void PluginManager::TerminateAllModules() {
 	_allModules.clear();
 }
 
-void PluginManager::SortPluginsByDependencies(const std::string& pluginName, PluginList& sourceList, PluginList& targetList) {
-	auto it = std::find_if(sourceList.begin(), sourceList.end(), [&pluginName](const auto& plugin) {
-		return plugin.GetName() == pluginName;
-	});
-	if (it != sourceList.end()) {
-		auto index = static_cast<size_t>(std::distance(sourceList.begin(), it));
-		auto plugin = std::move(sourceList[index]);
-		sourceList.erase(it);
-		if (const auto& dependencies = plugin.GetDescriptor().dependencies) {
-			for (const auto& dependency: *dependencies) {
-				SortPluginsByDependencies(dependency.name, sourceList, targetList);
-			}
-		}
-		targetList.emplace_back(std::move(plugin));
-	}
-}
+std::vector<std::vector<std::string>> PluginManager::SortPluginsByDependencies(PluginList& plugins) {
+	const size_t count = plugins.size();
 
-bool PluginManager::HasCyclicDependencies(PluginList& plugins) {
-	// Mark all the vertices as not visited
-	// and not part of recursion stack
-	VisitedPluginMap visitedPlugins; /* [visited, recursive] */
+	std::unordered_map<std::string_view, size_t> indices;
+	indices.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		indices.emplace(plugins[i].GetName(), i);
+	}
 
-	// Call the recursive helper function
-	// to detect cycle in different DFS trees
-	for (const auto& plugin : plugins) {
-		const auto& [visited, recursive] = visitedPlugins[plugin.GetName()];
-		if (!visited && IsCyclic(plugin, plugins, visitedPlugins))
-			return true;
+	// Build compact adjacency (plugin -> dependencies), missing dependencies are ignored here
+	std::vector<size_t> edgeOffsets(count + 1);
+	std::vector<size_t> edges;
+	std::vector<bool> selfDependent(count);
+	for (size_t i = 0; i < count; ++i) {
+		edgeOffsets[i] = edges.size();
+		if (const auto& dependencies = plugins[i].GetDescriptor().dependencies) {
+			for (const auto& dependency : *dependencies) {
+				auto it = indices.find(dependency.name);
+				if (it != indices.end()) {
+					auto index = std::get<size_t>(*it);
+					if (index == i) {
+						selfDependent[i] = true;
+					}
+					edges.push_back(index);
+				}
+			}
+		}
 	}
+	edgeOffsets[count] = edges.size();
+
+	// Iterative Tarjan: components are emitted after everything they depend on,
+	// so emission order is the load order and every non-trivial component is a cycle
+	constexpr size_t kUnvisited = std::numeric_limits<size_t>::max();
+	std::vector<size_t> order;
+	std::vector<size_t> visitIndex(count, kUnvisited);
+	std::vector<size_t> lowLink(count);
+	std::vector<size_t> nextEdge(count);
+	std::vector<bool> onStack(count);
+	std::vector<size_t> stack;
+	std::vector<size_t> callStack;
+	std::vector<std::vector<std::string>> cycles;
+	order.reserve(count);
+
+	size_t counter = 0;
+	auto visit = [&](size_t v) {
+		visitIndex[v] = lowLink[v] = counter++;
+		nextEdge[v] = edgeOffsets[v];
+		onStack[v] = true;
+		stack.push_back(v);
+		callStack.push_back(v);
+	};
+
+	// Walk from the back to keep the same preference as the previous recursive sort
+	for (size_t root = count; root-- > 0;) {
+		if (visitIndex[root] != kUnvisited)
+			continue;
 
-	return false;
-}
+		visit(root);
 
-bool PluginManager::IsCyclic(const Plugin& plugin, PluginList& plugins, VisitedPluginMap& visitedPlugins) {
-	auto& [visited, recursive] = visitedPlugins[plugin.GetName()];
-	if (!visited) {
-		// Mark the current node as visited
-		// and part of recursion stack
-		visited = true;
-		recursive = true;
+		while (!callStack.empty()) {
+			size_t v = callStack.back();
+			if (nextEdge[v] < edgeOffsets[v + 1]) {
+				size_t w = edges[nextEdge[v]++];
+				if (visitIndex[w] == kUnvisited) {
+					visit(w);
+				} else if (onStack[w]) {
+					lowLink[v] = std::min(lowLink[v], visitIndex[w]);
+				}
+				continue;
+			}
 
-		// Recur for all the vertices adjacent to this vertex
-		if (const auto& dependencies = plugin.GetDescriptor().dependencies) {
-			for (const auto& dependency : *dependencies) {
-				const auto& name = dependency.name;
+			callStack.pop_back();
+			if (!callStack.empty()) {
+				size_t u = callStack.back();
+				lowLink[u] = std::min(lowLink[u], lowLink[v]);
+			}
 
-				auto it = std::find_if(plugins.begin(), plugins.end(), [&name](const auto& p) {
-					return p.GetName() == name;
-				});
+			if (lowLink[v] != visitIndex[v])
+				continue;
 
-				if (it != plugins.end()) {
-					const auto& [vis, rec] = visitedPlugins[name];
-					if ((!vis && IsCyclic(*it, plugins, visitedPlugins)) || rec)
-						return true;
+			size_t first = order.size();
+			size_t w;
+			do {
+				w = stack.back();
+				stack.pop_back();
+				onStack[w] = false;
+				order.push_back(w);
+			} while (w != v);
+
+			if (order.size() - first > 1 || selfDependent[v]) {
+				auto& cycle = cycles.emplace_back();
+				cycle.reserve(order.size() - first);
+				for (size_t k = first; k < order.size(); ++k) {
+					cycle.emplace_back(plugins[order[k]].GetName());
 				}
 			}
 		}
 	}
 
-	// Remove the vertex from recursion stack
-	recursive = false;
-	return false;
+	PluginList sortedPlugins;
+	sortedPlugins.reserve(count);
+	for (size_t index : order) {
+		sortedPlugins.emplace_back(std::move(plugins[index]));
+	}
+	plugins = std::move(sortedPlugins);
+
+	return cycles;
 }
 
 ModuleHandle PluginManager::FindModule(std::string_view moduleName) const {
-	auto it = std::find_if(_allModules.begin(), _allModules.end(), [&moduleName](const auto& module) {
-		return module.GetName() == moduleName;
-	});
-	if (it != _allModules.end())
-		return *it;
+	auto it = _moduleNameIndex.find(moduleName);
+	if (it != _moduleNameIndex.end())
+		return _allModules[std::get<size_t>(*it)];
 	return {};
 }
 
 ModuleHandle PluginManager::FindModuleFromId(UniqueId moduleId) const {
-	auto it = std::find_if(_allModules.begin(), _allModules.end(), [&moduleId](const auto& module) {
-		return module.GetId() == moduleId;
-	});
-	if (it != _allModules.end())
-		return *it;
+	auto it = _moduleIdIndex.find(moduleId);
+	if (it != _moduleIdIndex.end())
+		return _allModules[std::get<size_t>(*it)];
 	return {};
 }
 
 ModuleHandle PluginManager::FindModuleFromLang(std::string_view moduleLang) const {
-	auto it = std::find_if(_allModules.begin(), _allModules.end(), [&moduleLang](const auto& module) {
-		return module.GetLanguage() == moduleLang;
-	});
-	if (it != _allModules.end())
-		return *it;
+	auto it = _moduleLangIndex.find(moduleLang);
+	if (it != _moduleLangIndex.end())
+		return _allModules[std::get<size_t>(*it)];
 	return {};
 }
 
 ModuleHandle PluginManager::FindModuleFromPath(const fs::path& moduleFilePath) const {
-	auto it = std::find_if(_allModules.begin(), _allModules.end(), [&moduleFilePath](const auto& module) {
-		return module.GetFilePath() == moduleFilePath;
-	});
-	if (it != _allModules.end())
-		return *it;
+	auto it = _modulePathIndex.find(moduleFilePath);
+	if (it != _modulePathIndex.end())
+		return _allModules[std::get<size_t>(*it)];
 	return {};
 }
 
@@ -360,31 +878,27 @@ std::vector<ModuleHandle> PluginManager::GetModules() const {
 }
 
 PluginHandle PluginManager::FindPlugin(std::string_view pluginName) const {
-	auto it = std::find_if(_allPlugins.begin(), _allPlugins.end(), [&pluginName](const auto& plugin) {
-		return plugin.GetName() == pluginName;
-	});
-	if (it != _allPlugins.end())
-		return *it;
+	auto it = _pluginNameIndex.find(pluginName);
+	if (it != _pluginNameIndex.end())
+		return _allPlugins[std::get<size_t>(*it)];
 	return {};
 }
 
 PluginHandle PluginManager::FindPluginFromId(UniqueId pluginId) const {
-	auto it = std::find_if(_allPlugins.begin(), _allPlugins.end(), [&pluginId](const auto& plugin) {
-		return plugin.GetId() == pluginId;
-	});
-	if (it != _allPlugins.end())
-		return *it;
+	auto it = _pluginIdIndex.find(pluginId);
+	if (it != _pluginIdIndex.end())
+		return _allPlugins[std::get<size_t>(*it)];
 	return {};
 }
 
 PluginHandle PluginManager::FindPluginFromDescriptor(const PluginReferenceDescriptorHandle & pluginDescriptor) const {
-	auto name = pluginDescriptor.GetName();
-	auto version = pluginDescriptor.GetRequestedVersion();
-	auto it = std::find_if(_allPlugins.begin(), _allPlugins.end(), [&name, &version](const auto& plugin) {
-		return plugin.GetName() == name && (!version || plugin.GetDescriptor().version == version);
-	});
-	if (it != _allPlugins.end())
-		return *it;
+	auto it = _pluginNameIndex.find(pluginDescriptor.GetName());
+	if (it != _pluginNameIndex.end()) {
+		const auto& plugin = _allPlugins[std::get<size_t>(*it)];
+		auto version = pluginDescriptor.GetRequestedVersion();
+		if (!version || plugin.GetDescriptor().version == version)
+			return plugin;
+	}
 	return {};
 }
 
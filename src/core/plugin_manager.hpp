@@ -4,6 +4,9 @@
 #include <plugify/language_module.hpp>
 #include <plugify/plugin.hpp>
 #include <plugify/plugin_manager.hpp>
+#include <utils/file_watcher.hpp>
+#include <utils/hash.hpp>
+#include <utils/thread_pool.hpp>
 
 namespace plugify {
 	class Plugin;
@@ -21,6 +24,7 @@ namespace plugify {
 		void Terminate() override;
 		bool IsInitialized() const override;
 		void Update(DateTime dt) override;
+		bool ReloadPlugin(std::string_view pluginName) override;
 
 		ModuleHandle FindModule(std::string_view moduleName) const override;
 		ModuleHandle FindModuleFromId(UniqueId moduleId) const override;
@@ -36,21 +40,67 @@ namespace plugify {
 	private:
 		using PluginList = std::vector<Plugin>;
 		using ModuleList = std::vector<Module>;
-		using VisitedPluginMap = std::unordered_map<std::string, std::pair<bool, bool>>;
+		using NameIndexMap = std::unordered_map<std::string, size_t, string_hash, std::equal_to<>>;
+		using IdIndexMap = std::unordered_map<UniqueId, size_t>;
+		using PathIndexMap = std::unordered_map<fs::path, size_t, path_hash>;
+
+		// Kept small and contiguous, the update tick only walks this list
+		struct UpdateEntry {
+			Module* module;
+			ILanguageModule* languageModule;
+			Plugin* plugin;
+			uint32_t divisor;
+			uint32_t phase;
+			DateTime elapsed;
+			bool deferred;
+		};
+
+		// Range of update entries which are processed by one thread
+		struct UpdateGroup {
+			Module* module{ nullptr };
+			size_t begin{ 0 };
+			size_t end{ 0 };
+			size_t cursor{ 0 };
+			size_t worker{ 0 };
+		};
 
 		void DiscoverAllModulesAndPlugins();
+		void BuildLookupTables();
 		void LoadRequiredLanguageModules();
 		void LoadAndStartAvailablePlugins();
+		void LoadAndStartAvailablePluginsParallel();
+		bool LoadPlugin(Plugin& plugin) const;
+		void ExportPlugin(Plugin& plugin) const;
+		std::vector<std::vector<Plugin*>> GetPluginLevels();
+		std::vector<size_t> GetDependentPlugins(size_t index) const;
+		void BuildUpdateList();
+		void UpdatePlugins(UpdateGroup& group, DateTime dt, uint64_t tick, DateTime frameStart);
+		void WatchPlugins();
+		void WatchPlugin(size_t index);
+		void ProcessHotReload();
 		void TerminateAllPlugins();
 		void TerminateAllModules();
 
-		static void SortPluginsByDependencies(const std::string& pluginName, PluginList& sourceList, PluginList& targetList);
-		static bool HasCyclicDependencies(PluginList& plugins);
-		static bool IsCyclic(const Plugin& plugin, PluginList& plugins, VisitedPluginMap& visitedPlugins);
+		static std::vector<std::vector<std::string>> SortPluginsByDependencies(PluginList& plugins);
 
 	private:
 		ModuleList _allModules;
 		PluginList _allPlugins;
+		NameIndexMap _pluginNameIndex;
+		IdIndexMap _pluginIdIndex;
+		NameIndexMap _moduleNameIndex;
+		NameIndexMap _moduleLangIndex;
+		IdIndexMap _moduleIdIndex;
+		PathIndexMap _modulePathIndex;
+		DateTime _updateBudget;
+		std::vector<UpdateEntry> _updateList;
+		std::vector<UpdateGroup> _updateGroups;
+		std::unique_ptr<ThreadPool> _updatePool;
+		uint64_t _updateTick{ 0 };
+		bool _updateListDirty{ true };
+		std::unique_ptr<IFileWatcher> _fileWatcher;
+		std::unordered_map<fs::path, size_t, path_hash> _watchedFiles;
+		std::unordered_map<size_t, DateTime> _pendingReloads;
 		bool _inited{ false };
 	};
 }
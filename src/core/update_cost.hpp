@@ -0,0 +1,6 @@
+#pragma once
+
+namespace plugify {
+	// Weight of the newest sample in the moving average of module and plugin update costs
+	inline constexpr float kUpdateCostFactor = 0.1f;
+}
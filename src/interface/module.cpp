@@ -40,6 +40,10 @@ std::string_view ModuleHandle::GetError() const noexcept {
 	return _impl->GetError();
 }
 
+DateTime ModuleHandle::GetUpdateCost() const noexcept {
+	return _impl->GetUpdateCost();
+}
+
 std::optional<fs::path_view> ModuleHandle::FindResource(fs::path_view path) const {
 	return _impl->FindResource(path);
 }
@@ -40,6 +40,10 @@ MemAddr PluginHandle::GetData() const noexcept {
 	return _impl->GetData();
 }
 
+DateTime PluginHandle::GetUpdateCost() const noexcept {
+	return _impl->GetUpdateCost();
+}
+
 std::optional<fs::path_view> PluginHandle::FindResource(fs::path_view path) const {
 	return _impl->FindResource(path);
 }
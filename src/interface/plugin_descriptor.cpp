@@ -74,6 +74,10 @@ std::string_view PluginDescriptorHandle::GetEntryPoint() const noexcept {
 	return _impl->entryPoint;
 }
 
+uint32_t PluginDescriptorHandle::GetUpdateDivisor() const noexcept {
+	return _impl->updateDivisor.value_or(1);
+}
+
 std::string_view PluginDescriptorHandle::GetLanguageModule() const noexcept {
 	return _impl->languageModule.name;
 }
@@ -0,0 +1,18 @@
+#pragma once
+
+namespace plugify {
+	class IFileWatcher {
+	public:
+		IFileWatcher() = default;
+		virtual ~IFileWatcher() = default;
+
+		// Starts to watch the file, replacing or removing it counts as a change as well
+		virtual bool Watch(const fs::path& file) = 0;
+		virtual void Unwatch(const fs::path& file) = 0;
+
+		// Returns the watched files which were changed since the last call, never blocks
+		virtual std::vector<fs::path> Poll() = 0;
+
+		static std::unique_ptr<IFileWatcher> Create();
+	};
+}
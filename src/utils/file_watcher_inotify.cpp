@@ -0,0 +1,106 @@
+#if PLUGIFY_PLATFORM_LINUX
+
+#include "file_watcher_inotify.hpp"
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+using namespace plugify;
+
+static constexpr uint32_t kWatchMask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+
+FileWatcherInotify::FileWatcherInotify() : IFileWatcher() {}
+
+FileWatcherInotify::~FileWatcherInotify() {
+	if (_fd != -1)
+		close(_fd);
+}
+
+std::unique_ptr<IFileWatcher> IFileWatcher::Create() {
+	auto instance = std::make_unique<FileWatcherInotify>();
+	if (!instance->Initialize())
+		return {};
+
+	return instance;
+}
+
+bool FileWatcherInotify::Initialize() {
+	_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (_fd == -1) {
+		PL_LOG_ERROR("inotify_init1() failed: {}", std::strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
+bool FileWatcherInotify::Watch(const fs::path& file) {
+	auto directory = file.parent_path();
+	int wd = inotify_add_watch(_fd, directory.c_str(), kWatchMask);
+	if (wd == -1) {
+		PL_LOG_WARNING("Could not watch: '{}' - {}", directory.string(), std::strerror(errno));
+		return false;
+	}
+
+	// The same directory always gets the same descriptor
+	auto& watch = _watches[wd];
+	watch.directory = std::move(directory);
+	if (std::find(watch.files.begin(), watch.files.end(), file) == watch.files.end()) {
+		watch.files.push_back(file);
+	}
+	return true;
+}
+
+void FileWatcherInotify::Unwatch(const fs::path& file) {
+	for (auto it = _watches.begin(); it != _watches.end();) {
+		auto& [wd, watch] = *it;
+		std::erase(watch.files, file);
+		if (watch.files.empty()) {
+			inotify_rm_watch(_fd, wd);
+			it = _watches.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+std::vector<fs::path> FileWatcherInotify::Poll() {
+	std::vector<fs::path> changed;
+
+	alignas(inotify_event) std::array<char, 4096> buffer;
+
+	for (;;) {
+		auto length = read(_fd, buffer.data(), buffer.size());
+		if (length <= 0)
+			break;
+
+		for (ssize_t offset = 0; offset < length;) {
+			const auto* event = reinterpret_cast<const inotify_event*>(buffer.data() + offset);
+			offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+			auto it = _watches.find(event->wd);
+			if (it == _watches.end())
+				continue;
+
+			if (event->mask & IN_IGNORED) {
+				_watches.erase(it);
+				continue;
+			}
+
+			if (event->len == 0)
+				continue;
+
+			// Anything else in the directory, like logs or configs written by the plugin, is not ours
+			std::string_view name(event->name);
+			for (const auto& file : it->second.files) {
+				if (file.filename() == name && std::find(changed.begin(), changed.end(), file) == changed.end()) {
+					changed.push_back(file);
+				}
+			}
+		}
+	}
+
+	return changed;
+}
+
+#endif // PLUGIFY_PLATFORM_LINUX
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "file_watcher.hpp"
+
+namespace plugify {
+	class FileWatcherInotify final : public IFileWatcher {
+	public:
+		FileWatcherInotify();
+		~FileWatcherInotify() override;
+
+		bool Initialize();
+
+		bool Watch(const fs::path& file) override;
+		void Unwatch(const fs::path& file) override;
+		std::vector<fs::path> Poll() override;
+
+	private:
+		// Files are watched through their directory, so being replaced by rename is noticed too
+		struct WatchEntry {
+			fs::path directory;
+			std::vector<fs::path> files;
+		};
+
+		std::unordered_map<int, WatchEntry> _watches;
+		int _fd{ -1 };
+	};
+}
@@ -0,0 +1,61 @@
+#if !PLUGIFY_PLATFORM_LINUX
+
+#include "file_watcher_poll.hpp"
+
+using namespace plugify;
+
+FileWatcherPoll::FileWatcherPoll() : IFileWatcher() {}
+
+std::unique_ptr<IFileWatcher> IFileWatcher::Create() {
+	return std::make_unique<FileWatcherPoll>();
+}
+
+bool FileWatcherPoll::Watch(const fs::path& file) {
+	Unwatch(file);
+	_files.emplace_back(WatchEntry{ file, GetStamp(file) });
+	return true;
+}
+
+void FileWatcherPoll::Unwatch(const fs::path& file) {
+	std::erase_if(_files, [&](const WatchEntry& entry) {
+		return entry.path == file;
+	});
+}
+
+std::vector<fs::path> FileWatcherPoll::Poll() {
+	std::vector<fs::path> changed;
+
+	// Only a couple of stats per plugin, but the tick should not pay for them every time
+	auto now = DateTime::Now();
+	if (now - _lastPoll < DateTime(kPollInterval))
+		return changed;
+	_lastPoll = now;
+
+	for (auto& [path, stamp] : _files) {
+		auto current = GetStamp(path);
+		if (current != stamp) {
+			stamp = current;
+			changed.emplace_back(path);
+		}
+	}
+
+	return changed;
+}
+
+FileWatcherPoll::Stamp FileWatcherPoll::GetStamp(const fs::path& file) {
+	Stamp stamp{};
+	std::error_code ec;
+	auto lastWriteTime = fs::last_write_time(file, ec);
+	if (ec)
+		return stamp;
+	auto fileSize = fs::file_size(file, ec);
+	if (ec)
+		return stamp;
+
+	stamp.lastWriteTime = static_cast<int64_t>(lastWriteTime.time_since_epoch().count());
+	stamp.fileSize = static_cast<uint64_t>(fileSize);
+	stamp.exists = true;
+	return stamp;
+}
+
+#endif // !PLUGIFY_PLATFORM_LINUX
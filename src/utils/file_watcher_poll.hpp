@@ -0,0 +1,39 @@
+#pragma once
+
+#include "file_watcher.hpp"
+#include <plugify/date_time.hpp>
+
+namespace plugify {
+	// Portable fallback which compares file stamps instead of using native notifications
+	class FileWatcherPoll final : public IFileWatcher {
+	public:
+		FileWatcherPoll();
+		~FileWatcherPoll() override = default;
+
+		bool Watch(const fs::path& file) override;
+		void Unwatch(const fs::path& file) override;
+		std::vector<fs::path> Poll() override;
+
+	private:
+		struct Stamp {
+			int64_t lastWriteTime;
+			uint64_t fileSize;
+			bool exists;
+
+			bool operator==(const Stamp&) const noexcept = default;
+		};
+
+		struct WatchEntry {
+			fs::path path;
+			Stamp stamp;
+		};
+
+		static Stamp GetStamp(const fs::path& file);
+
+		static constexpr auto kPollInterval = 500ms;
+
+	private:
+		std::vector<WatchEntry> _files;
+		DateTime _lastPoll;
+	};
+}
@@ -3,32 +3,32 @@
 #include "http_downloader.hpp"
 #include "strings.hpp"
 
-#include <thread>
-
 using namespace plugify;
 
 static constexpr float DEFAULT_TIMEOUT_IN_SECONDS = 30;
-static constexpr uint32_t DEFAULT_MAX_ACTIVE_REQUESTS = 4;
+static constexpr uint32_t DEFAULT_MAX_ACTIVE_REQUESTS = 16;
+static constexpr uint32_t DEFAULT_MAX_ACTIVE_REQUESTS_PER_HOST = 4;
+static constexpr uint32_t DEFAULT_MAX_RETRIES = 3;
+static constexpr float DEFAULT_RETRY_DELAY_IN_SECONDS = 1;
+static constexpr float MAX_RETRY_DELAY_IN_SECONDS = 60;
 
-IHTTPDownloader::IHTTPDownloader() : _timeout{DEFAULT_TIMEOUT_IN_SECONDS}, _maxActiveRequests{DEFAULT_MAX_ACTIVE_REQUESTS} {}
+IHTTPDownloader::IHTTPDownloader() : _timeout{DEFAULT_TIMEOUT_IN_SECONDS}, _retryDelay{DEFAULT_RETRY_DELAY_IN_SECONDS}, _maxActiveRequests{DEFAULT_MAX_ACTIVE_REQUESTS}, _maxActiveRequestsPerHost{DEFAULT_MAX_ACTIVE_REQUESTS_PER_HOST}, _maxRetries{DEFAULT_MAX_RETRIES} {}
 
 IHTTPDownloader::~IHTTPDownloader() = default;
 
 void IHTTPDownloader::CreateRequest(std::string url, Request::Callback callback, ProgressCallback progress) {
+	// Bodies are kept in memory, so they are small and needed before anything else
 	Request* req = InternalCreateRequest();
 	req->parent = this;
 	req->type = Request::Type::Get;
 	req->url = std::move(url);
+	req->host = GetHostForURL(req->url);
 	req->callback = std::move(callback);
 	req->progress = std::move(progress);
+	req->priority = Priority::High;
 	req->startTime = DateTime::Now();
 
 	std::unique_lock<std::mutex> lock(_pendingRequestLock);
-	if (LockedGetActiveRequestCount() < _maxActiveRequests) {
-		if (!StartRequest(req))
-			return;
-	}
-
 	LockedAddRequest(req);
 }
 
@@ -37,136 +37,500 @@ void IHTTPDownloader::CreatePostRequest(std::string url, std::string postData, R
 	req->parent = this;
 	req->type = Request::Type::Post;
 	req->url = std::move(url);
+	req->host = GetHostForURL(req->url);
 	req->postData = std::move(postData);
 	req->callback = std::move(callback);
 	req->progress = std::move(progress);
+	req->priority = Priority::High;
 	req->startTime = DateTime::Now();
 
 	std::unique_lock<std::mutex> lock(_pendingRequestLock);
-	if (LockedGetActiveRequestCount() < _maxActiveRequests) {
-		if (!StartRequest(req))
-			return;
+	LockedAddRequest(req);
+}
+
+void IHTTPDownloader::CreateFileRequest(std::string url, fs::path filePath, std::string checksum, Request::FileCallback callback, ProgressCallback progress) {
+	Request* req = InternalCreateRequest();
+	req->parent = this;
+	req->type = Request::Type::Get;
+	req->url = std::move(url);
+	req->host = GetHostForURL(req->url);
+	req->filePath = std::move(filePath);
+	if (!checksum.empty()) {
+		req->checksum = std::move(checksum);
+		req->sha.emplace();
 	}
+	req->fileCallback = std::move(callback);
+	req->progress = std::move(progress);
+	req->startTime = DateTime::Now();
+
+	// Partial body left by an earlier attempt is continued instead of downloaded again
+	std::error_code ec;
+	auto fileSize = fs::file_size(req->filePath, ec);
+	if (!ec)
+		req->resumeOffset = static_cast<uint32_t>(fileSize);
 
+	std::unique_lock<std::mutex> lock(_pendingRequestLock);
 	LockedAddRequest(req);
 }
 
+void IHTTPDownloader::CreateConditionalRequest(std::string url, Validators condition, Request::ConditionalCallback callback, ProgressCallback progress) {
+	Request* req = InternalCreateRequest();
+	req->parent = this;
+	req->type = Request::Type::Get;
+	req->url = std::move(url);
+	req->host = GetHostForURL(req->url);
+	req->condition = std::move(condition);
+	req->conditionalCallback = std::move(callback);
+	req->progress = std::move(progress);
+	req->priority = Priority::High;
+	req->startTime = DateTime::Now();
+
+	std::unique_lock<std::mutex> lock(_pendingRequestLock);
+	LockedAddRequest(req);
+}
+
+bool IHTTPDownloader::Request::OpenFile() {
+	// Writes are already done in network sized chunks, stream buffering would only add a copy
+	file.rdbuf()->pubsetbuf(nullptr, 0);
+
+	if (resumed) {
+		// Server continues after the partial body, so its bytes have to be hashed first
+		if (sha) {
+			std::ifstream is(filePath, std::ios::binary);
+			std::vector<char> buffer(1 << 16);
+			uint64_t remaining = resumeOffset;
+			while (remaining > 0 && is) {
+				is.read(buffer.data(), static_cast<std::streamsize>(std::min<uint64_t>(buffer.size(), remaining)));
+				auto read = static_cast<size_t>(is.gcount());
+				if (read == 0)
+					break;
+				sha->update({ reinterpret_cast<const uint8_t*>(buffer.data()), read });
+				remaining -= read;
+			}
+			if (remaining > 0) {
+				PL_LOG_ERROR("Request for '{}' could not read partial file '{}'", url, filePath.string());
+				return false;
+			}
+		}
+
+		file.open(filePath, std::ios::binary | std::ios::in | std::ios::out);
+		file.seekp(resumeOffset);
+		bytesReceived = resumeOffset;
+		if (contentLength > 0)
+			contentLength += resumeOffset;
+	} else {
+		file.open(filePath, std::ios::binary | std::ios::trunc);
+	}
+
+	if (!file.is_open()) {
+		PL_LOG_ERROR("Request for '{}' could not open file '{}'", url, filePath.string());
+		return false;
+	}
+
+	// Allocate the whole body up front, so the file does not grow on every chunk
+	if (contentLength > bytesReceived) {
+		std::error_code ec;
+		fs::resize_file(filePath, contentLength, ec);
+	}
+
+	return true;
+}
+
+void IHTTPDownloader::Request::CloseFile() {
+	if (!file.is_open())
+		return;
+
+	file.close();
+
+	// Transfer could end before the announced length, drop the tail which was never written
+	if (bytesReceived != contentLength) {
+		std::error_code ec;
+		fs::resize_file(filePath, bytesReceived, ec);
+	}
+}
+
+bool IHTTPDownloader::Request::Receive(const void* ptr, size_t size) {
+	auto bytes = static_cast<const uint8_t*>(ptr);
+
+	if (IsFile() && !file.is_open() && !OpenFile())
+		return false;
+
+	if (sha) {
+		// More bytes than announced can not match the expected digest anymore, so stop right away
+		if (contentLength > 0 && bytesReceived + size > contentLength) {
+			PL_LOG_ERROR("Request for '{}' received more than {} bytes announced, aborting", url, contentLength);
+			statusCode = HTTP_STATUS_CHECKSUM_MISMATCH;
+			return false;
+		}
+
+		sha->update({ bytes, size });
+	}
+
+	if (!IsFile()) {
+		if (data.empty() && contentLength > 0)
+			data.reserve(contentLength);
+
+		data.insert(data.end(), bytes, bytes + size);
+		bytesReceived += static_cast<uint32_t>(size);
+	} else {
+		file.write(reinterpret_cast<const char*>(bytes), static_cast<std::streamsize>(size));
+		bytesReceived += static_cast<uint32_t>(size);
+		if (!file.good())
+			return false;
+	}
+
+	// Digest is ready with the last byte, so completion does not wait on hashing
+	if (sha && bytesReceived == contentLength) {
+		digest = Sha256::ToString(sha->digest());
+	}
+
+	return true;
+}
+
+bool IHTTPDownloader::Request::VerifyChecksum() {
+	if (!sha)
+		return true;
+
+	if (digest.empty()) {
+		digest = Sha256::ToString(sha->digest());
+	}
+
+	PL_LOG_VERBOSE("Expected checksum: {}", checksum);
+	PL_LOG_VERBOSE("Computed checksum: {}", digest);
+
+	return digest == checksum;
+}
+
+void IHTTPDownloader::InvokeCallback(Request* request, int32_t statusCode) {
+	if (request->conditionalCallback) {
+		request->conditionalCallback(statusCode, request->contentType, std::move(request->data), std::move(request->validators));
+		return;
+	}
+
+	if (!request->IsFile()) {
+		request->callback(statusCode, request->contentType, std::move(request->data));
+		return;
+	}
+
+	request->CloseFile();
+	request->fileCallback(statusCode, request->contentType, request->filePath);
+}
+
+bool IHTTPDownloader::RetryRequest(Request* request, int32_t statusCode) {
+	// Only file bodies can be continued, everything else is left to the caller
+	if (!request->IsFile() || request->attempt >= _maxRetries)
+		return false;
+
+	bool restart = false;
+	if (statusCode == HTTP_STATUS_RANGE_NOT_SATISFIABLE || (statusCode == HTTP_STATUS_CHECKSUM_MISMATCH && request->resumeOffset > 0)) {
+		// Partial body is useless, so start over from the first byte
+		restart = true;
+	} else if (statusCode != HTTP_STATUS_TIMEOUT && statusCode != HTTP_STATUS_ERROR && statusCode < 500) {
+		return false;
+	}
+
+	Request* retry = InternalCreateRequest();
+	if (!retry)
+		return false;
+
+	request->CloseFile();
+
+	std::error_code ec;
+	if (restart) {
+		fs::remove(request->filePath, ec);
+	}
+
+	retry->parent = this;
+	retry->type = request->type;
+	retry->url = request->url;
+	retry->host = request->host;
+	retry->filePath = request->filePath;
+	if (!request->checksum.empty()) {
+		retry->checksum = request->checksum;
+		retry->sha.emplace();
+	}
+	retry->fileCallback = std::move(request->fileCallback);
+	retry->progress = std::move(request->progress);
+	retry->attempt = request->attempt + 1;
+	retry->priority = request->priority;
+
+	auto fileSize = fs::file_size(retry->filePath, ec);
+	if (!ec)
+		retry->resumeOffset = static_cast<uint32_t>(fileSize);
+
+	// Exponential backoff, so a struggling server is not hammered
+	float delay = std::min(_retryDelay * static_cast<float>(1u << std::min(request->attempt, 16u)), MAX_RETRY_DELAY_IN_SECONDS);
+	retry->retryTime = DateTime::Now() + DateTime::Seconds(delay);
+	retry->startTime = retry->retryTime;
+
+	PL_LOG_WARNING("Request for '{}' failed with {}, retrying in {}s from byte {} ({}/{})", retry->url, statusCode, delay, retry->resumeOffset, retry->attempt, _maxRetries);
+
+	std::unique_lock<std::mutex> lock(_pendingRequestLock);
+	LockedQueueRequest(retry);
+	return true;
+}
+
+void IHTTPDownloader::LockedFinishRequest(std::unique_lock<std::mutex>& lock, Request* request, int32_t statusCode) {
+	// run callback with lock unheld
+	lock.unlock();
+
+	if (statusCode == HTTP_STATUS_PARTIAL_CONTENT && request->resumed)
+		statusCode = HTTP_STATUS_OK;
+
+	if (statusCode == HTTP_STATUS_OK && !request->VerifyChecksum()) {
+		PL_LOG_ERROR("Request for '{}' does not match expected checksum", request->url);
+		statusCode = HTTP_STATUS_CHECKSUM_MISMATCH;
+	}
+
+	if (!RetryRequest(request, statusCode))
+		InvokeCallback(request, statusCode);
+
+	CloseRequest(request);
+	lock.lock();
+}
+
 void IHTTPDownloader::LockedPollRequests(std::unique_lock<std::mutex>& lock) {
-	if (_pendingRequests.empty())
+	if (_activeRequests.empty() && _pendingRequests.empty())
 		return;
 
+	LockedResumeRequests();
 	InternalPollRequests();
 
 	auto currentTime = DateTime::Now();
-	uint32_t activeRequests = 0;
-	uint32_t unstartedRequests = 0;
 
-	for (size_t index = 0; index < _pendingRequests.size();) {
-		Request* req = _pendingRequests[index];
-		if (req->state == Request::State::Pending) {
-			unstartedRequests++;
-			index++;
-			continue;
-		}
+	// Finished requests are swapped with the last one, so the order of active requests is not kept
+	for (size_t index = 0; index < _activeRequests.size();) {
+		Request* req = _activeRequests[index];
 
 		bool alive = (req->state == Request::State::Started || req->state == Request::State::Receiving);
 		if (alive) {
+			// Throttled transfer is silent on purpose, it is not a stalled one
+			if (req->paused) {
+				req->startTime = currentTime;
+			}
+
 			if (currentTime >= req->startTime && (currentTime - req->startTime).AsSeconds() >= _timeout) {
 				PL_LOG_ERROR("Request for '{}' timed out", req->url);
 
 				req->state.store(Request::State::Cancelled);
-				_pendingRequests.erase(_pendingRequests.begin() + static_cast<ptrdiff_t>(index));
-
-				// run callback with lock unheld
-				lock.unlock();
-				req->callback(HTTP_STATUS_TIMEOUT, {}, {});
-				CloseRequest(req);
-				lock.lock();
+				LockedRemoveActiveRequest(index);
+				LockedFinishRequest(lock, req, HTTP_STATUS_TIMEOUT);
 				continue;
 			} else if (req->progress && !req->progress(req->lastProgressUpdate, req->contentLength)) {
 				PL_LOG_ERROR("Request for '{}' cancelled", req->url);
 
 				req->state.store(Request::State::Cancelled);
-				_pendingRequests.erase(_pendingRequests.begin() + static_cast<ptrdiff_t>(index));
-
-				// run callback with lock unheld
-				lock.unlock();
-				req->callback(HTTP_STATUS_CANCELLED, {}, {});
-				CloseRequest(req);
-				lock.lock();
+				LockedRemoveActiveRequest(index);
+				LockedFinishRequest(lock, req, HTTP_STATUS_CANCELLED);
 				continue;
 			}
 		}
 
 		if (req->state != Request::State::Complete) {
-			req->lastProgressUpdate = static_cast<uint32_t>(req->data.size());
-			activeRequests++;
+			req->lastProgressUpdate = req->bytesReceived;
 			index++;
 			continue;
 		}
 
-		PL_LOG_VERBOSE("Request for '{}' complete, returned status code {} and {} bytes", req->url, req->statusCode, req->data.size());
-		_pendingRequests.erase(_pendingRequests.begin() + static_cast<ptrdiff_t>(index));
-
-		// run callback with lock unheld
-		lock.unlock();
-		req->callback(req->statusCode, req->contentType, std::move(req->data));
-		CloseRequest(req);
-		lock.lock();
+		PL_LOG_VERBOSE("Request for '{}' complete, returned status code {} and {} bytes", req->url, req->statusCode, req->bytesReceived);
+		LockedRemoveActiveRequest(index);
+		LockedFinishRequest(lock, req, req->statusCode);
 	}
 
-	// start new requests when we finished some
-	if (unstartedRequests > 0 && activeRequests < _maxActiveRequests) {
-		for (size_t index = 0; index < _pendingRequests.size();) {
-			Request* req = _pendingRequests[index];
-			if (req->state != Request::State::Pending) {
-				index++;
-				continue;
-			}
-
-			if (!StartRequest(req)) {
-				_pendingRequests.erase(_pendingRequests.begin() + static_cast<ptrdiff_t>(index));
-				continue;
-			}
-
-			activeRequests++;
-			index++;
-
-			if (activeRequests >= _maxActiveRequests)
-				break;
+	// start new requests when we finished some, requests to busy hosts keep their place in the queue
+	for (auto it = _pendingRequests.begin(); it != _pendingRequests.end() && LockedGetActiveRequestCount() < _maxActiveRequests;) {
+		Request* req = *it;
+		if (!LockedCanStartRequest(req)) {
+			++it;
+			continue;
 		}
+
+		it = _pendingRequests.erase(it);
+		LockedStartRequest(req);
 	}
 }
 
 void IHTTPDownloader::PollRequests() {
 	std::unique_lock<std::mutex> lock(_pendingRequestLock);
+	// Waiting thread owns the transfers until it wakes up
+	if (_waiting)
+		return;
 	LockedPollRequests(lock);
 }
 
 void IHTTPDownloader::WaitForAllRequests() {
 	std::unique_lock<std::mutex> lock(_pendingRequestLock);
-	while (!_pendingRequests.empty()) {
-		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	PL_ASSERT(!_waiting && "Only one thread can wait for requests");
+
+	for (;;) {
 		LockedPollRequests(lock);
+		if (_activeRequests.empty() && _pendingRequests.empty())
+			break;
+
+		// Lock is released while blocked, so other threads can queue requests and wake us up
+		_waiting = true;
+		lock.unlock();
+		InternalWaitForEvents(kWaitTimeout);
+		lock.lock();
+		_waiting = false;
+	}
+}
+
+void IHTTPDownloader::InternalWaitForEvents(std::chrono::milliseconds timeout) {
+	std::unique_lock<std::mutex> lock(_eventLock);
+	_eventCondition.wait_for(lock, timeout, [this] { return _eventSignaled; });
+	_eventSignaled = false;
+}
+
+void IHTTPDownloader::InternalWakeup() {
+	{
+		std::unique_lock<std::mutex> lock(_eventLock);
+		_eventSignaled = true;
 	}
+	_eventCondition.notify_one();
 }
 
 void IHTTPDownloader::LockedAddRequest(Request* request) {
-	_pendingRequests.push_back(request);
+	// Transfers can not be touched while another thread waits on them, so let it start the request
+	if (_waiting || LockedGetActiveRequestCount() >= _maxActiveRequests || !LockedCanStartRequest(request)) {
+		LockedQueueRequest(request);
+		if (_waiting)
+			InternalWakeup();
+		return;
+	}
+
+	LockedStartRequest(request);
 }
 
-uint32_t IHTTPDownloader::LockedGetActiveRequestCount() {
-	uint32_t count = 0;
-	for (Request* req : _pendingRequests) {
-		if (req->state == Request::State::Started || req->state == Request::State::Receiving)
-			count++;
+void IHTTPDownloader::LockedQueueRequest(Request* request) {
+	// Queue is kept ordered by priority, requests of the same priority stay in FIFO order
+	auto it = std::find_if(_pendingRequests.begin(), _pendingRequests.end(), [request](const Request* queued) {
+		return queued->priority > request->priority;
+	});
+	_pendingRequests.insert(it, request);
+}
+
+void IHTTPDownloader::LockedStartRequest(Request* request) {
+	// Keep a copy, request is freed when it fails to start
+	std::string host = request->host;
+	if (!StartRequest(request))
+		return;
+
+	_activeRequests.push_back(request);
+	++_hostActiveRequests[std::move(host)];
+}
+
+void IHTTPDownloader::LockedRemoveActiveRequest(size_t index) {
+	Request* req = _activeRequests[index];
+	auto it = _hostActiveRequests.find(req->host);
+	if (it != _hostActiveRequests.end() && --it->second == 0)
+		_hostActiveRequests.erase(it);
+
+	_activeRequests[index] = _activeRequests.back();
+	_activeRequests.pop_back();
+}
+
+IHTTPDownloader::Priority IHTTPDownloader::GetEffectivePriority(const Request* request) {
+	if (request->priority == Priority::Normal && request->contentLength > kLargeRequestSize)
+		return Priority::Low;
+	return request->priority;
+}
+
+bool IHTTPDownloader::AcquireBandwidth(Request* request, size_t size) {
+	if (request->priority == Priority::High)
+		return true;
+
+	std::unique_lock<std::mutex> lock(_bandwidthLock);
+	if (_maxBytesPerSecond == 0)
+		return true;
+
+	// Budget may go below zero by one chunk, the debt is paid by the next refill
+	if (_bandwidthTokens <= 0) {
+		request->paused = true;
+		return false;
+	}
+
+	_bandwidthTokens -= static_cast<double>(size);
+	return true;
+}
+
+void IHTTPDownloader::LockedResumeRequests() {
+	{
+		std::unique_lock<std::mutex> lock(_bandwidthLock);
+		auto currentTime = DateTime::Now();
+		if (_maxBytesPerSecond != 0) {
+			// At most one second worth of bytes is accumulated, so an idle period does not turn into a burst
+			auto rate = static_cast<double>(_maxBytesPerSecond);
+			_bandwidthTokens = std::min(_bandwidthTokens + (currentTime - _bandwidthTime).AsSeconds<double>() * rate, rate);
+		}
+		_bandwidthTime = currentTime;
+	}
+
+	std::vector<Request*> paused;
+	for (Request* req : _activeRequests) {
+		if (req->paused)
+			paused.push_back(req);
+	}
+
+	if (paused.empty())
+		return;
+
+	// Priority first, then the transfer closest to the end, so small packages are not stuck behind large ones
+	auto getRemaining = [](const Request* req) {
+		return req->contentLength > req->bytesReceived ? req->contentLength - req->bytesReceived : std::numeric_limits<uint32_t>::max();
+	};
+	std::sort(paused.begin(), paused.end(), [&](const Request* lhs, const Request* rhs) {
+		auto lhsPriority = GetEffectivePriority(lhs);
+		auto rhsPriority = GetEffectivePriority(rhs);
+		if (lhsPriority != rhsPriority)
+			return lhsPriority < rhsPriority;
+		return getRemaining(lhs) < getRemaining(rhs);
+	});
+
+	for (Request* req : paused) {
+		{
+			std::unique_lock<std::mutex> lock(_bandwidthLock);
+			if (_maxBytesPerSecond != 0 && _bandwidthTokens <= 0)
+				break;
+		}
+
+		req->paused = false;
+		InternalResumeRequest(req);
 	}
-	return count;
+}
+
+uint32_t IHTTPDownloader::LockedGetActiveRequestCount() {
+	return static_cast<uint32_t>(_activeRequests.size());
+}
+
+bool IHTTPDownloader::LockedCanStartRequest(const Request* request) {
+	if (request->attempt > 0 && request->retryTime > DateTime::Now())
+		return false;
+
+	auto it = _hostActiveRequests.find(request->host);
+	return it == _hostActiveRequests.end() || it->second < GetMaxActiveRequests(request->host);
+}
+
+uint32_t IHTTPDownloader::GetMaxActiveRequests(std::string_view host) const {
+	auto it = _hostLimits.find(host);
+	return it != _hostLimits.end() ? it->second : _maxActiveRequestsPerHost;
 }
 
 bool IHTTPDownloader::HasAnyRequests() {
 	std::unique_lock<std::mutex> lock(_pendingRequestLock);
-	return !_pendingRequests.empty();
+	return !_activeRequests.empty() || !_pendingRequests.empty();
+}
+
+std::string_view IHTTPDownloader::GetHostForURL(std::string_view url) {
+	// scheme://[user@]host[:port]/path
+	size_t begin = url.find("://");
+	begin = begin == std::string_view::npos ? 0 : begin + 3;
+	size_t end = url.find_first_of("/?#", begin);
+	std::string_view authority = url.substr(begin, end == std::string_view::npos ? std::string_view::npos : end - begin);
+	size_t at = authority.rfind('@');
+	if (at != std::string_view::npos)
+		authority.remove_prefix(at + 1);
+	return authority;
 }
 
 std::string_view IHTTPDownloader::GetExtensionForContentType(std::string_view contentType) {
@@ -1,24 +1,48 @@
 #pragma once
 
 #include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
 #include <plugify/date_time.hpp>
+#include <utils/hash.hpp>
+#include <utils/sha256.hpp>
 
 namespace plugify {
 	class IHTTPDownloader {
 	public:
 		enum {
+			HTTP_STATUS_CHECKSUM_MISMATCH = -4,
 			HTTP_STATUS_CANCELLED = -3,
 			HTTP_STATUS_TIMEOUT = -2,
 			HTTP_STATUS_ERROR = -1,
-			HTTP_STATUS_OK = 200
+			HTTP_STATUS_OK = 200,
+			HTTP_STATUS_PARTIAL_CONTENT = 206,
+			HTTP_STATUS_NOT_MODIFIED = 304,
+			HTTP_STATUS_RANGE_NOT_SATISFIABLE = 416
 		};
 
 		// Progress callback. If you return false, then the operation is cancelled
 		using ProgressCallback = std::function<bool(uint32_t bytesDone, uint32_t bytesTotal)>;
 
+		// Cache validators of a response, sent back as If-None-Match and If-Modified-Since
+		struct Validators {
+			std::string etag;
+			std::string lastModified;
+		};
+
+		// Lower value goes first, high priority requests are never throttled
+		enum class Priority : uint8_t {
+			High,
+			Normal,
+			Low,
+		};
+
 		struct Request {
 			using Data = std::vector<uint8_t>;
 			using Callback = std::function<void(int32_t statusCode, std::string_view contentType, Data data)>;
+			using FileCallback = std::function<void(int32_t statusCode, std::string_view contentType, const fs::path& filePath)>;
+			using ConditionalCallback = std::function<void(int32_t statusCode, std::string_view contentType, Data data, Validators validators)>;
 
 			enum class Type {
 				Get,
@@ -33,16 +57,46 @@ namespace plugify {
 				Complete,
 			};
 
+			bool IsFile() const noexcept {
+				return !filePath.empty();
+			}
+
+			// Opens the target file, continuing after resumeOffset when the server accepted the range
+			bool OpenFile();
+			void CloseFile();
+
+			// Appends received bytes to the data buffer or to the target file
+			bool Receive(const void* ptr, size_t size);
+			// Finalizes the running hash of the body, returns false when it differs from the expected one
+			bool VerifyChecksum();
+
 			IHTTPDownloader * parent{};
 			Callback callback;
+			FileCallback fileCallback;
+			ConditionalCallback conditionalCallback;
 			ProgressCallback progress;
 			std::string url;
+			std::string host;
 			std::string postData;
 			std::string contentType;
 			Data data;
+			fs::path filePath;
+			std::ofstream file;
+			std::string checksum;
+			std::string digest;
+			std::optional<Sha256> sha;
+			Validators condition;
+			Validators validators;
 			DateTime startTime;
+			DateTime retryTime;
 			int32_t statusCode{};
 			uint32_t contentLength{};
+			uint32_t bytesReceived{};
+			uint32_t resumeOffset{};
+			uint32_t attempt{};
+			Priority priority{ Priority::Normal };
+			bool resumed{};
+			std::atomic<bool> paused{ false };
 			uint32_t lastProgressUpdate{};
 			Type type{ Type::Get };
 			std::atomic<State> state{ State::Pending };
@@ -53,9 +107,15 @@ namespace plugify {
 
 		static std::unique_ptr<IHTTPDownloader> Create(std::string userAgent = kDefaultUserAgent);
 		static std::string_view GetExtensionForContentType(std::string_view contentType);
+		static std::string_view GetHostForURL(std::string_view url);
 
 		void CreateRequest(std::string url, Request::Callback callback, ProgressCallback progress = nullptr);
 		void CreatePostRequest(std::string url, std::string postData, Request::Callback callback, ProgressCallback progress = nullptr);
+		// Body is streamed into the file instead of memory, callback receives the path once the file is closed
+		// When checksum is not empty, SHA-256 of the body is computed while receiving and checked on completion
+		void CreateFileRequest(std::string url, fs::path filePath, std::string checksum, Request::FileCallback callback, ProgressCallback progress = nullptr);
+		// Sends the validators of a cached response, server answers with HTTP_STATUS_NOT_MODIFIED and no body if it is still valid
+		void CreateConditionalRequest(std::string url, Validators condition, Request::ConditionalCallback callback, ProgressCallback progress = nullptr);
 		void PollRequests();
 		void WaitForAllRequests();
 		bool HasAnyRequests();
@@ -64,11 +124,40 @@ namespace plugify {
 			_timeout = timeout;
 		}
 
+		// Global cap for the bodies of normal and low priority requests, 0 to disable
+		void SetMaxBytesPerSecond(uint64_t maxBytesPerSecond) {
+			std::unique_lock<std::mutex> lock(_bandwidthLock);
+			_maxBytesPerSecond = maxBytesPerSecond;
+		}
+
+		// Failed file requests are resumed up to maxRetries times, waiting delay * 2^attempt seconds in between
+		void SetRetryPolicy(uint32_t maxRetries, float delay) {
+			_maxRetries = maxRetries;
+			_retryDelay = delay;
+		}
+
 		void SetMaxActiveRequests(uint32_t maxActiveRequests) {
 			_maxActiveRequests = maxActiveRequests;
 		}
 
+		// Limit of concurrent requests to a host without a limit of its own
+		void SetMaxActiveRequestsPerHost(uint32_t maxActiveRequests) {
+			std::unique_lock<std::mutex> lock(_pendingRequestLock);
+			_maxActiveRequestsPerHost = maxActiveRequests;
+			OnHostLimitChanged();
+		}
+
+		void SetMaxActiveRequestsForHost(std::string_view host, uint32_t maxActiveRequests) {
+			std::unique_lock<std::mutex> lock(_pendingRequestLock);
+			_hostLimits.insert_or_assign(std::string(host), maxActiveRequests);
+			OnHostLimitChanged();
+		}
+
 		static inline const char* const kDefaultUserAgent = "Mozilla/5.0 (Windows NT 10.0; Win64; x64; rv:85.0) Gecko/20100101 Firefox/85.0";
+		// Upper bound of a single wait, so timeouts and progress are still checked on idle transfers
+		static inline std::chrono::milliseconds kWaitTimeout{ 100 };
+		// File requests bigger than this are scheduled after everything else
+		static inline uint32_t kLargeRequestSize = 32 << 20;
 
 	protected:
 		virtual Request* InternalCreateRequest() = 0;
@@ -77,14 +166,57 @@ namespace plugify {
 		virtual bool StartRequest(Request* request) = 0;
 		virtual void CloseRequest(Request* request) = 0;
 
+		// Called with the request lock held, lets backend apply the new per host limit to its connections
+		virtual void OnHostLimitChanged() {}
+
+		// Continues a transfer which was paused by AcquireBandwidth
+		virtual void InternalResumeRequest(Request* request) = 0;
+
+		// Blocks until a transfer makes progress, the timeout expires or InternalWakeup is called
+		virtual void InternalWaitForEvents(std::chrono::milliseconds timeout);
+		virtual void InternalWakeup();
+
+		static void InvokeCallback(Request* request, int32_t statusCode);
+		static Priority GetEffectivePriority(const Request* request);
+
+		// Called by backends before a chunk is consumed, on false the transfer should be paused until resumed
+		bool AcquireBandwidth(Request* request, size_t size);
+		void LockedResumeRequests();
+
+		bool RetryRequest(Request* request, int32_t statusCode);
+		void LockedFinishRequest(std::unique_lock<std::mutex>& lock, Request* request, int32_t statusCode);
+
 		void LockedAddRequest(Request* request);
+		void LockedQueueRequest(Request* request);
+		void LockedStartRequest(Request* request);
+		void LockedRemoveActiveRequest(size_t index);
 		uint32_t LockedGetActiveRequestCount();
+		bool LockedCanStartRequest(const Request* request);
+		uint32_t GetMaxActiveRequests(std::string_view host) const;
 		void LockedPollRequests(std::unique_lock<std::mutex>& lock);
 
+		using HostMap = std::unordered_map<std::string, uint32_t, string_hash, std::equal_to<>>;
+
 		float _timeout;
+		float _retryDelay;
 		uint32_t _maxActiveRequests;
+		uint32_t _maxActiveRequestsPerHost;
+		uint32_t _maxRetries;
+		HostMap _hostLimits;
+		HostMap _hostActiveRequests;
 
 		std::mutex _pendingRequestLock;
-		std::vector<Request*> _pendingRequests;
+		std::deque<Request*> _pendingRequests;
+		std::vector<Request*> _activeRequests;
+		bool _waiting{ false };
+
+		std::mutex _bandwidthLock;
+		uint64_t _maxBytesPerSecond{ 0 };
+		double _bandwidthTokens{ 0 };
+		DateTime _bandwidthTime;
+
+		std::mutex _eventLock;
+		std::condition_variable _eventCondition;
+		bool _eventSignaled{ false };
 	};
 }
@@ -1,8 +1,11 @@
 #if !PLUGIFY_PLATFORM_WINDOWS && PLUGIFY_DOWNLOADER
 
 #include "http_downloader_curl.hpp"
+#include "strings.hpp"
 
 #include <curl/curl.h>
+#include <algorithm>
+#include <cctype>
 #include <csignal>
 
 using namespace plugify;
@@ -10,8 +13,15 @@ using namespace plugify;
 HTTPDownloaderCurl::HTTPDownloaderCurl() : IHTTPDownloader() {}
 
 HTTPDownloaderCurl::~HTTPDownloaderCurl() {
+	for (CURL* handle : _handlePool)
+		curl_easy_cleanup(handle);
+
 	if (_multiHandle)
 		curl_multi_cleanup(_multiHandle);
+
+	// share can be released only when no easy handle uses it anymore
+	if (_shareHandle)
+		curl_share_cleanup(_shareHandle);
 }
 
 std::unique_ptr<IHTTPDownloader> IHTTPDownloader::Create(std::string userAgent) {
@@ -47,30 +57,102 @@ bool HTTPDownloaderCurl::Initialize(std::string userAgent) {
 		return false;
 	}
 
+	// Requests to the same host can share one connection through HTTP/2 streams
+	curl_multi_setopt(_multiHandle, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+	OnHostLimitChanged();
+
+	// DNS results, TLS sessions and connections outlive a single transfer.
+	// No lock callbacks are needed, curl is only ever driven by one thread at a time.
+	_shareHandle = curl_share_init();
+	if (_shareHandle) {
+		curl_share_setopt(_shareHandle, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+		curl_share_setopt(_shareHandle, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+		curl_share_setopt(_shareHandle, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+	} else {
+		PL_LOG_WARNING("curl_share_init() failed, connections will not be shared");
+	}
+
 	_userAgent = std::move(userAgent);
 	return true;
 }
 
 size_t HTTPDownloaderCurl::WriteCallback(char* ptr, size_t size, size_t nmemb, void* userdata) {
 	auto req = static_cast<Request*>(userdata);
-	const size_t currentSize = req->data.size();
 	const size_t transferSize = size * nmemb;
-	const size_t newSize = currentSize + transferSize;
-	req->data.resize(newSize);
 	req->startTime = DateTime::Now();
-	std::memcpy(&req->data[currentSize], ptr, transferSize);
 
+	// Range could be ignored by the server, then the whole body is sent again
+	if (req->resumeOffset > 0 && !req->file.is_open()) {
+		long responseCode = 0;
+		curl_easy_getinfo(req->handle, CURLINFO_RESPONSE_CODE, &responseCode);
+		// file:// has no status line, but always starts at the requested offset
+		req->resumed = responseCode == HTTP_STATUS_PARTIAL_CONTENT || responseCode == 0;
+	}
+
+	// Length is known before the first chunk, so the destination can be sized once
 	if (req->contentLength == 0) {
 		curl_off_t length;
-		if (curl_easy_getinfo(req->handle, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length) == CURLE_OK)
+		if (curl_easy_getinfo(req->handle, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length) == CURLE_OK && length > 0)
 			req->contentLength = static_cast<uint32_t>(length);
 	}
 
-	return nmemb;
+	// Chunk is delivered again once the transfer is resumed
+	if (!static_cast<HTTPDownloaderCurl*>(req->parent)->AcquireBandwidth(req, transferSize))
+		return CURL_WRITEFUNC_PAUSE;
+
+	// Returning less than was passed aborts the transfer
+	if (!req->Receive(ptr, transferSize))
+		return 0;
+
+	return transferSize;
+}
+
+size_t HTTPDownloaderCurl::HeaderCallback(char* buffer, size_t size, size_t nitems, void* userdata) {
+	auto req = static_cast<Request*>(userdata);
+	const size_t length = size * nitems;
+	std::string_view header(buffer, length);
+
+	// Every response of a redirect chain starts with its own status line
+	if (header.starts_with("HTTP/")) {
+		req->validators = {};
+		return length;
+	}
+
+	size_t colon = header.find(':');
+	if (colon == std::string_view::npos)
+		return length;
+
+	std::string_view name = header.substr(0, colon);
+	std::string_view value = header.substr(colon + 1);
+	while (!value.empty() && std::isspace(static_cast<unsigned char>(value.front())))
+		value.remove_prefix(1);
+	while (!value.empty() && std::isspace(static_cast<unsigned char>(value.back())))
+		value.remove_suffix(1);
+
+	auto isHeader = [&name](std::string_view expected) {
+		return name.size() == expected.size() && String::Strncasecmp(name.data(), expected.data(), name.size()) == 0;
+	};
+
+	if (isHeader("ETag")) {
+		req->validators.etag = value;
+	} else if (isHeader("Last-Modified")) {
+		req->validators.lastModified = value;
+	}
+
+	return length;
 }
 
 IHTTPDownloader::Request* HTTPDownloaderCurl::InternalCreateRequest() {
 	Request* req = new Request();
+
+	std::unique_lock<std::mutex> lock(_pendingRequestLock);
+	if (!_handlePool.empty()) {
+		req->handle = _handlePool.back();
+		_handlePool.pop_back();
+		return req;
+	}
+	lock.unlock();
+
 	req->handle = curl_easy_init();
 	if (!req->handle) {
 		delete req;
@@ -115,15 +197,23 @@ void HTTPDownloaderCurl::InternalPollRequests() {
 		if (msg->data.result == CURLE_OK) {
 			long response_code = 0;
 			curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &response_code);
-			req->statusCode = static_cast<int32_t>(response_code);
+			// Protocols without a status line, like file://, report no code for a completed transfer
+			req->statusCode = response_code != 0 ? static_cast<int32_t>(response_code) : HTTP_STATUS_OK;
 
 			char* content_type = nullptr;
 			if (curl_easy_getinfo(req->handle, CURLINFO_CONTENT_TYPE, &content_type) == CURLE_OK && content_type)
 				req->contentType = content_type;
 
-			PL_LOG_VERBOSE("Request for '{}' returned status code {} and {} bytes", req->url, req->statusCode, req->data.size());
+			PL_LOG_VERBOSE("Request for '{}' returned status code {} and {} bytes", req->url, req->statusCode, req->bytesReceived);
+		} else if (msg->data.result == CURLE_RANGE_ERROR) {
+			// Server ignored the range and sent the whole body, curl refuses that, so the partial file is dropped
+			PL_LOG_WARNING("Request for '{}' could not be resumed from byte {}", req->url, req->resumeOffset);
+			req->statusCode = HTTP_STATUS_RANGE_NOT_SATISFIABLE;
 		} else {
 			PL_LOG_ERROR("Request for '{}' returned error {}", req->url, static_cast<int>(msg->data.result));
+			// Keep the reason when the transfer was aborted by the write callback
+			if (req->statusCode == 0)
+				req->statusCode = HTTP_STATUS_ERROR;
 		}
 
 		req->state.store(Request::State::Complete, std::memory_order_release);
@@ -133,6 +223,24 @@ void HTTPDownloaderCurl::InternalPollRequests() {
 		PL_LOG_WARNING("Failed to unblock SIGPIPE");
 }
 
+void HTTPDownloaderCurl::InternalWaitForEvents(std::chrono::milliseconds timeout) {
+	// Returns as soon as any socket of the multi handle is ready, or curl_multi_wakeup is called
+	const CURLMcode err = curl_multi_poll(_multiHandle, nullptr, 0, static_cast<int>(timeout.count()), nullptr);
+	if (err != CURLM_OK)
+		PL_LOG_ERROR("curl_multi_poll() returned {}", static_cast<int>(err));
+}
+
+void HTTPDownloaderCurl::InternalResumeRequest(IHTTPDownloader::Request* request) {
+	auto req = static_cast<Request*>(request);
+	const CURLcode err = curl_easy_pause(req->handle, CURLPAUSE_CONT);
+	if (err != CURLE_OK)
+		PL_LOG_ERROR("curl_easy_pause() returned {}", static_cast<int>(err));
+}
+
+void HTTPDownloaderCurl::InternalWakeup() {
+	curl_multi_wakeup(_multiHandle);
+}
+
 bool HTTPDownloaderCurl::StartRequest(IHTTPDownloader::Request* request) {
 	auto req = static_cast<Request*>(request);
 	curl_easy_setopt(req->handle, CURLOPT_URL, request->url.c_str());
@@ -142,6 +250,24 @@ bool HTTPDownloaderCurl::StartRequest(IHTTPDownloader::Request* request) {
 	curl_easy_setopt(req->handle, CURLOPT_NOSIGNAL, 1L);
 	curl_easy_setopt(req->handle, CURLOPT_PRIVATE, req);
 	curl_easy_setopt(req->handle, CURLOPT_FOLLOWLOCATION, 1L);
+	curl_easy_setopt(req->handle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+	// Rather wait for a connection which can multiplex, than open a new one
+	curl_easy_setopt(req->handle, CURLOPT_PIPEWAIT, 1L);
+	if (_shareHandle)
+		curl_easy_setopt(req->handle, CURLOPT_SHARE, _shareHandle);
+
+	if (request->resumeOffset > 0)
+		curl_easy_setopt(req->handle, CURLOPT_RESUME_FROM_LARGE, static_cast<curl_off_t>(request->resumeOffset));
+
+	curl_easy_setopt(req->handle, CURLOPT_HEADERFUNCTION, &HTTPDownloaderCurl::HeaderCallback);
+	curl_easy_setopt(req->handle, CURLOPT_HEADERDATA, req);
+
+	if (!request->condition.etag.empty())
+		req->headers = curl_slist_append(req->headers, std::format("If-None-Match: {}", request->condition.etag).c_str());
+	if (!request->condition.lastModified.empty())
+		req->headers = curl_slist_append(req->headers, std::format("If-Modified-Since: {}", request->condition.lastModified).c_str());
+	if (req->headers)
+		curl_easy_setopt(req->handle, CURLOPT_HTTPHEADER, req->headers);
 
 	if (request->type == Request::Type::Post) {
 		curl_easy_setopt(req->handle, CURLOPT_POST, 1L);
@@ -155,7 +281,8 @@ bool HTTPDownloaderCurl::StartRequest(IHTTPDownloader::Request* request) {
 	const CURLMcode err = curl_multi_add_handle(_multiHandle, req->handle);
 	if (err != CURLM_OK) {
 		PL_LOG_ERROR("curl_multi_add_handle() returned {}", static_cast<int>(err));
-		req->callback(HTTP_STATUS_ERROR, {}, req->data);
+		InvokeCallback(req, HTTP_STATUS_ERROR);
+		curl_slist_free_all(req->headers);
 		curl_easy_cleanup(req->handle);
 		delete req;
 		return false;
@@ -168,8 +295,31 @@ void HTTPDownloaderCurl::CloseRequest(IHTTPDownloader::Request* request) {
 	auto req = static_cast<Request*>(request);
 	PL_ASSERT(req->handle);
 	curl_multi_remove_handle(_multiHandle, req->handle);
-	curl_easy_cleanup(req->handle);
+	curl_slist_free_all(req->headers);
+
+	std::unique_lock<std::mutex> lock(_pendingRequestLock);
+	if (_handlePool.size() < kMaxPooledHandles) {
+		// Options are set again on start, reset keeps the caches of the handle
+		curl_easy_reset(req->handle);
+		_handlePool.push_back(req->handle);
+	} else {
+		curl_easy_cleanup(req->handle);
+	}
+	lock.unlock();
+
 	delete req;
 }
 
+void HTTPDownloaderCurl::OnHostLimitChanged() {
+	if (!_multiHandle)
+		return;
+
+	// Curl has one limit for every host, so it gets the highest one and lower limits are kept by the request queue
+	uint32_t maxConnections = _maxActiveRequestsPerHost;
+	for (const auto& [_, limit] : _hostLimits) {
+		maxConnections = std::max(maxConnections, limit);
+	}
+	curl_multi_setopt(_multiHandle, CURLMOPT_MAX_HOST_CONNECTIONS, static_cast<long>(maxConnections));
+}
+
 #endif // !PLUGIFY_PLATFORM_WINDOWS && PLUGIFY_DOWNLOADER
@@ -5,6 +5,8 @@
 extern "C" {
 	typedef void CURL;
 	typedef void CURLM;
+	typedef void CURLSH;
+	struct curl_slist;
 }
 
 namespace plugify {
@@ -20,15 +22,26 @@ namespace plugify {
 		void InternalPollRequests() override;
 		bool StartRequest(IHTTPDownloader::Request* request) override;
 		void CloseRequest(IHTTPDownloader::Request* request) override;
+		void InternalWaitForEvents(std::chrono::milliseconds timeout) override;
+		void InternalWakeup() override;
+		void InternalResumeRequest(IHTTPDownloader::Request* request) override;
+		void OnHostLimitChanged() override;
 
 	private:
 		struct Request : IHTTPDownloader::Request {
 			CURL* handle{ nullptr };
+			curl_slist* headers{ nullptr };
 		};
 
 		static size_t WriteCallback(char* ptr, size_t size, size_t nmemb, void* userdata);
+		static size_t HeaderCallback(char* buffer, size_t size, size_t nitems, void* userdata);
 
 		CURLM* _multiHandle{ nullptr };
+		CURLSH* _shareHandle{ nullptr };
+		std::vector<CURL*> _handlePool;
 		std::string _userAgent;
+
+		// Finished easy handles are kept, so their buffers and caches are reused by the next request
+		static inline size_t kMaxPooledHandles = 16;
 	};
 }
@@ -42,8 +42,36 @@ bool HTTPDownloaderWinHttp::Initialize(std::string userAgent) {
 	return true;
 }
 
+static bool QueryHeaderString(HINTERNET hRequest, DWORD infoLevel, std::string& value) {
+	DWORD length = 0;
+	if (WinHttpQueryHeaders(hRequest, infoLevel, WINHTTP_HEADER_NAME_BY_INDEX, WINHTTP_NO_OUTPUT_BUFFER, &length, WINHTTP_NO_HEADER_INDEX) ||
+		GetLastError() != ERROR_INSUFFICIENT_BUFFER || length < sizeof(wchar_t)) {
+		return false;
+	}
+
+	std::wstring wide;
+	wide.resize((length / sizeof(wchar_t)) - 1);
+	if (!WinHttpQueryHeaders(hRequest, infoLevel, WINHTTP_HEADER_NAME_BY_INDEX, wide.data(), &length, WINHTTP_NO_HEADER_INDEX))
+		return false;
+
+	value = String::ConvertWideToUtf8(wide);
+	return true;
+}
+
 void CALLBACK HTTPDownloaderWinHttp::HTTPStatusCallback(HINTERNET hRequest, DWORD_PTR dwContext, DWORD dwInternetStatus, LPVOID lpvStatusInformation, DWORD dwStatusInformationLength) {
 	Request* req = reinterpret_cast<Request*>(dwContext);
+	if (!req || dwInternetStatus == WINHTTP_CALLBACK_STATUS_HANDLE_CLOSING) {
+		HandleStatus(hRequest, req, dwInternetStatus, lpvStatusInformation, dwStatusInformationLength);
+		return;
+	}
+
+	// Request state could change, so wake up the thread waiting for requests
+	auto parent = static_cast<HTTPDownloaderWinHttp*>(req->parent);
+	HandleStatus(hRequest, req, dwInternetStatus, lpvStatusInformation, dwStatusInformationLength);
+	parent->InternalWakeup();
+}
+
+void HTTPDownloaderWinHttp::HandleStatus(HINTERNET hRequest, Request* req, DWORD dwInternetStatus, LPVOID lpvStatusInformation, DWORD dwStatusInformationLength) {
 	switch (dwInternetStatus) {
 		case WINHTTP_CALLBACK_STATUS_HANDLE_CREATED:
 			return;
@@ -57,6 +85,7 @@ void CALLBACK HTTPDownloaderWinHttp::HTTPStatusCallback(HINTERNET hRequest, DWOR
 			auto parent = static_cast<HTTPDownloaderWinHttp*>(req->parent);
 			std::unique_lock<std::mutex> lock(parent->_pendingRequestLock);
 			PL_ASSERT(std::none_of(parent->_pendingRequests.begin(), parent->_pendingRequests.end(), [req](IHTTPDownloader::Request* it) { return it == req; }));
+			PL_ASSERT(std::none_of(parent->_activeRequests.begin(), parent->_activeRequests.end(), [req](IHTTPDownloader::Request* it) { return it == req; }));
 
 			// we can clean up the connection as well
 			PL_ASSERT(req->hConnection != NULL);
@@ -105,20 +134,16 @@ void CALLBACK HTTPDownloaderWinHttp::HTTPStatusCallback(HINTERNET hRequest, DWOR
 				req->contentLength = 0;
 			}
 
-			DWORD contentTypeLength = 0;
-			if (!WinHttpQueryHeaders(hRequest, WINHTTP_QUERY_CONTENT_TYPE, WINHTTP_HEADER_NAME_BY_INDEX,
-									 WINHTTP_NO_OUTPUT_BUFFER, &contentTypeLength, WINHTTP_NO_HEADER_INDEX) &&
-				GetLastError() == ERROR_INSUFFICIENT_BUFFER && contentTypeLength >= sizeof(contentTypeLength)) {
-				std::wstring contentTypeWstring;
-				contentTypeWstring.resize((contentTypeLength / sizeof(wchar_t)) - 1);
-				if (WinHttpQueryHeaders(hRequest, WINHTTP_QUERY_CONTENT_TYPE, WINHTTP_HEADER_NAME_BY_INDEX,
-										contentTypeWstring.data(), &contentTypeLength, WINHTTP_NO_HEADER_INDEX)) {
-					req->contentType = String::ConvertWideToUtf8(contentTypeWstring);
-				}
-			}
+			QueryHeaderString(hRequest, WINHTTP_QUERY_CONTENT_TYPE, req->contentType);
+			QueryHeaderString(hRequest, WINHTTP_QUERY_ETAG, req->validators.etag);
+			QueryHeaderString(hRequest, WINHTTP_QUERY_LAST_MODIFIED, req->validators.lastModified);
+
+			// Range could be ignored by the server, then the whole body is sent again
+			req->resumed = req->resumeOffset > 0 && req->statusCode == HTTP_STATUS_PARTIAL_CONTENT;
 
 			PL_LOG_VERBOSE("Status code {}, content-length is {}", req->statusCode, req->contentLength);
-			req->data.reserve(req->contentLength);
+			if (!req->IsFile())
+				req->data.reserve(req->contentLength);
 			req->state = Request::State::Receiving;
 
 			// start reading
@@ -136,14 +161,15 @@ void CALLBACK HTTPDownloaderWinHttp::HTTPStatusCallback(HINTERNET hRequest, DWOR
 			std::memcpy(&bytesAvailable, lpvStatusInformation, sizeof(bytesAvailable));
 			if (bytesAvailable == 0) {
 				// end of request
-				PL_LOG_VERBOSE("End of request '{}', {} bytes received", req->url, req->data.size());
+				PL_LOG_VERBOSE("End of request '{}', {} bytes received", req->url, req->bytesReceived);
 				req->state.store(Request::State::Complete);
 				return;
 			}
 
 			// start the transfer
 			PL_LOG_VERBOSE("{} bytes available", bytesAvailable);
-			req->ioPosition = static_cast<uint32_t>(req->data.size());
+			// In file mode the data buffer only holds the chunk in flight
+			req->ioPosition = req->IsFile() ? 0 : static_cast<uint32_t>(req->data.size());
 			req->data.resize(req->ioPosition + bytesAvailable);
 			if (!WinHttpReadData(hRequest, req->data.data() + req->ioPosition, bytesAvailable, nullptr) &&
 				GetLastError() != ERROR_IO_PENDING) {
@@ -160,9 +186,24 @@ void CALLBACK HTTPDownloaderWinHttp::HTTPStatusCallback(HINTERNET hRequest, DWOR
 
 			const uint32_t newSize = req->ioPosition + dwStatusInformationLength;
 			PL_ASSERT(newSize <= req->data.size());
-			req->data.resize(newSize);
 			req->startTime = DateTime::Now();
 
+			if (req->IsFile()) {
+				if (!req->Receive(req->data.data(), dwStatusInformationLength)) {
+					if (req->statusCode != HTTP_STATUS_CHECKSUM_MISMATCH)
+						req->statusCode = HTTP_STATUS_ERROR;
+					req->state.store(Request::State::Complete);
+					return;
+				}
+			} else {
+				req->data.resize(newSize);
+				req->bytesReceived = newSize;
+			}
+
+			// Next read is issued by InternalResumeRequest once bandwidth is available again
+			if (!static_cast<HTTPDownloaderWinHttp*>(req->parent)->AcquireBandwidth(req, dwStatusInformationLength))
+				return;
+
 			if (!WinHttpQueryDataAvailable(hRequest, nullptr) && GetLastError() != ERROR_IO_PENDING) {
 				PL_LOG_ERROR("WinHttpQueryDataAvailable() failed: {}", GetLastError());
 				req->statusCode = HTTP_STATUS_ERROR;
@@ -204,7 +245,7 @@ bool HTTPDownloaderWinHttp::StartRequest(IHTTPDownloader::Request* request) {
 	const std::wstring urlWide = String::ConvertUtf8ToWide(req->url);
 	if (!WinHttpCrackUrl(urlWide.c_str(), static_cast<DWORD>(urlWide.size()), 0, &uc)) {
 		PL_LOG_ERROR("WinHttpCrackUrl() failed: {}", GetLastError());
-		req->callback(HTTP_STATUS_ERROR, {}, req->data);
+		InvokeCallback(req, HTTP_STATUS_ERROR);
 		delete req;
 		return false;
 	}
@@ -215,7 +256,7 @@ bool HTTPDownloaderWinHttp::StartRequest(IHTTPDownloader::Request* request) {
 	req->hConnection = WinHttpConnect(_hSession, hostName.c_str(), uc.nPort, 0);
 	if (!req->hConnection) {
 		PL_LOG_ERROR("Failed to start HTTP request for '{}': {}", req->url, GetLastError());
-		req->callback(HTTP_STATUS_ERROR, {}, req->data);
+		InvokeCallback(req, HTTP_STATUS_ERROR);
 		delete req;
 		return false;
 	}
@@ -233,7 +274,19 @@ bool HTTPDownloaderWinHttp::StartRequest(IHTTPDownloader::Request* request) {
 		const std::wstring_view additionalHeaders = L"Content-Type: application/x-www-form-urlencoded\r\n";
 		result = WinHttpSendRequest(req->hRequest, additionalHeaders.data(), static_cast<DWORD>(additionalHeaders.size()), req->postData.data(), static_cast<DWORD>(req->postData.size()), static_cast<DWORD>(req->postData.size()), reinterpret_cast<DWORD_PTR>(req));
 	} else {
-		result = WinHttpSendRequest(req->hRequest, WINHTTP_NO_ADDITIONAL_HEADERS, 0, WINHTTP_NO_REQUEST_DATA, 0, 0, reinterpret_cast<DWORD_PTR>(req));
+		std::wstring additionalHeaders;
+		if (!req->condition.etag.empty())
+			additionalHeaders += String::ConvertUtf8ToWide(std::format("If-None-Match: {}\r\n", req->condition.etag));
+		if (!req->condition.lastModified.empty())
+			additionalHeaders += String::ConvertUtf8ToWide(std::format("If-Modified-Since: {}\r\n", req->condition.lastModified));
+		if (req->resumeOffset > 0)
+			additionalHeaders += String::ConvertUtf8ToWide(std::format("Range: bytes={}-\r\n", req->resumeOffset));
+
+		if (additionalHeaders.empty()) {
+			result = WinHttpSendRequest(req->hRequest, WINHTTP_NO_ADDITIONAL_HEADERS, 0, WINHTTP_NO_REQUEST_DATA, 0, 0, reinterpret_cast<DWORD_PTR>(req));
+		} else {
+			result = WinHttpSendRequest(req->hRequest, additionalHeaders.data(), static_cast<DWORD>(additionalHeaders.size()), WINHTTP_NO_REQUEST_DATA, 0, 0, reinterpret_cast<DWORD_PTR>(req));
+		}
 	}
 
 	if (!result && GetLastError() != ERROR_IO_PENDING) {
@@ -248,6 +301,15 @@ bool HTTPDownloaderWinHttp::StartRequest(IHTTPDownloader::Request* request) {
 	return true;
 }
 
+void HTTPDownloaderWinHttp::InternalResumeRequest(IHTTPDownloader::Request* request) {
+	auto req = static_cast<Request*>(request);
+	if (!WinHttpQueryDataAvailable(req->hRequest, nullptr) && GetLastError() != ERROR_IO_PENDING) {
+		PL_LOG_ERROR("WinHttpQueryDataAvailable() failed: {}", GetLastError());
+		req->statusCode = HTTP_STATUS_ERROR;
+		req->state.store(Request::State::Complete);
+	}
+}
+
 void HTTPDownloaderWinHttp::CloseRequest(IHTTPDownloader::Request* request) {
 	auto req = static_cast<Request*>(request);
 
@@ -18,6 +18,7 @@ namespace plugify {
 		void InternalPollRequests() override;
 		bool StartRequest(IHTTPDownloader::Request* request) override;
 		void CloseRequest(IHTTPDownloader::Request* request) override;
+		void InternalResumeRequest(IHTTPDownloader::Request* request) override;
 
 	private:
 		struct Request : IHTTPDownloader::Request {
@@ -28,6 +29,7 @@ namespace plugify {
 		};
 
 		static void CALLBACK HTTPStatusCallback(HINTERNET hInternet, DWORD_PTR dwContext, DWORD dwInternetStatus, LPVOID lpvStatusInformation, DWORD dwStatusInformationLength);
+		static void HandleStatus(HINTERNET hInternet, Request* req, DWORD dwInternetStatus, LPVOID lpvStatusInformation, DWORD dwStatusInformationLength);
 
 		HINTERNET _hSession{ NULL };
 		std::string _userAgent;
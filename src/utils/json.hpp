@@ -2,8 +2,11 @@
 
 #include <glaze/glaze.hpp>
 
+#include <core/descriptor_cache.hpp>
 #include <core/language_module_descriptor.hpp>
+#include <core/manifest_cache.hpp>
 #include <core/method.hpp>
+#include <core/package_manifest.hpp>
 #include <core/plugin_descriptor.hpp>
 #include <plugify/config.hpp>
 #include <plugify/descriptor.hpp>
@@ -89,6 +92,7 @@ struct glz::meta<plugify::PluginDescriptor> {
 			"resourceDirectories", &T::resourceDirectories,
 			"entryPoint", &T::entryPoint,
 			"languageModule", &T::languageModule,
+			"updateDivisor", &T::updateDivisor,
 			"dependencies", &T::dependencies,
 			"exportedMethods", &T::exportedMethods
 	);
@@ -136,7 +140,18 @@ struct glz::meta<plugify::Config> {
 			"baseDir", &T::baseDir,
 			"logSeverity", &T::logSeverity,
 			"repositories", &T::repositories,
-			"preferOwnSymbols", &T::preferOwnSymbols
+			"preferOwnSymbols", &T::preferOwnSymbols,
+			"parallelStartup", &T::parallelStartup,
+			"workerThreads", &T::workerThreads,
+			"updateBudget", &T::updateBudget,
+			"hotReload", &T::hotReload,
+			"descriptorCache", &T::descriptorCache,
+			"descriptorCacheChecksum", &T::descriptorCacheChecksum,
+			"manifestCache", &T::manifestCache,
+			"manifestCacheTTL", &T::manifestCacheTTL,
+			"downloadRetries", &T::downloadRetries,
+			"downloadRetryDelay", &T::downloadRetryDelay,
+			"downloadSpeedLimit", &T::downloadSpeedLimit
 	);
 };
 
@@ -235,6 +250,50 @@ struct glz::meta<plugify::Method> {
 	);
 };
 
+template <>
+struct glz::meta<plugify::DescriptorCacheEntry> {
+	using T = plugify::DescriptorCacheEntry;
+	static constexpr auto value = object(
+			"path", &T::path,
+			"lastWriteTime", &T::lastWriteTime,
+			"fileSize", &T::fileSize,
+			"checksum", &T::checksum,
+			"plugin", &T::plugin,
+			"module", &T::module
+	);
+};
+
+template <>
+struct glz::meta<plugify::DescriptorCacheData> {
+	using T = plugify::DescriptorCacheData;
+	static constexpr auto value = object(
+			"fileVersion", &T::fileVersion,
+			"plugifyVersion", &T::plugifyVersion,
+			"entries", &T::entries
+	);
+};
+
+template <>
+struct glz::meta<plugify::ManifestCacheEntry> {
+	using T = plugify::ManifestCacheEntry;
+	static constexpr auto value = object(
+			"url", &T::url,
+			"etag", &T::etag,
+			"lastModified", &T::lastModified,
+			"fetchTime", &T::fetchTime,
+			"body", &T::body
+	);
+};
+
+template <>
+struct glz::meta<plugify::ManifestCacheData> {
+	using T = plugify::ManifestCacheData;
+	static constexpr auto value = object(
+			"fileVersion", &T::fileVersion,
+			"entries", &T::entries
+	);
+};
+
 namespace glz::detail {
 	template <>
 	struct from_json<fs::path> {
@@ -272,4 +331,41 @@ namespace glz::detail {
 			write<json>::op<Opts>(value.to_string_noexcept(), args...);
 		}
 	};
+
+	template <>
+	struct from_binary<fs::path> {
+		template <auto Opts>
+		static void op(fs::path& value, auto&&... args) {
+			std::string str;
+			read<binary>::op<Opts>(str, args...);
+			value = str;
+			if (!value.empty()) value.make_preferred();
+		}
+	};
+
+	template <>
+	struct to_binary<fs::path> {
+		template <auto Opts>
+		static void op(const fs::path& value, auto&&... args) noexcept {
+			write<binary>::op<Opts>(value.generic_string(), args...);
+		}
+	};
+
+	template <>
+	struct from_binary<plg::version> {
+		template <auto Opts>
+		static void op(plg::version& value, auto&&... args) {
+			std::string str;
+			read<binary>::op<Opts>(str, args...);
+			value.from_string_noexcept(str);
+		}
+	};
+
+	template <>
+	struct to_binary<plg::version> {
+		template <auto Opts>
+		static void op(const plg::version& value, auto&&... args) noexcept {
+			write<binary>::op<Opts>(value.to_string_noexcept(), args...);
+		}
+	};
 }
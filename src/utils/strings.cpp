@@ -47,5 +47,11 @@ bool String::ConvertWideToUtf8(std::string& dest, std::wstring_view str) {
 
 bool String::IsValidURL(std::string_view url) {
 	static std::regex regex(R"(^((http[s]?|ftp):\/)?\/?([^:\/\s]+)((\/\w+)*\/)([\w\-\.]+[^#?\s]+)(.*)?(#[\w\-]+)?$)");
+#if !PLUGIFY_PLATFORM_WINDOWS
+	// Local repositories and packages, curl reads them like any other transfer
+	static std::regex fileRegex(R"(^file:\/\/\/[^#?\s]+$)");
+	if (!url.empty() && std::regex_match(url.begin(), url.end(), fileRegex))
+		return true;
+#endif // !PLUGIFY_PLATFORM_WINDOWS
 	return !url.empty() && std::regex_match(url.begin(), url.end(), regex);
 }
\ No newline at end of file
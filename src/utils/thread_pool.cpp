@@ -0,0 +1,94 @@
+#include "thread_pool.hpp"
+
+using namespace plugify;
+
+ThreadPool::ThreadPool(size_t threadCount) {
+	if (threadCount == 0)
+		threadCount = GetDefaultThreadCount();
+
+	_localTasks.resize(threadCount);
+	_workers.reserve(threadCount);
+	for (size_t i = 0; i < threadCount; ++i) {
+		_workers.emplace_back(&ThreadPool::Run, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_taskCondition.notify_all();
+
+	for (auto& worker : _workers) {
+		if (worker.joinable())
+			worker.join();
+	}
+}
+
+void ThreadPool::Enqueue(Task task) {
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_sharedTasks.emplace_back(std::move(task));
+		++_pendingTasks;
+	}
+	_taskCondition.notify_one();
+}
+
+void ThreadPool::Enqueue(size_t worker, Task task) {
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_localTasks[worker % _localTasks.size()].emplace_back(std::move(task));
+		++_pendingTasks;
+	}
+	// the worker which owns the queue could be any of them
+	_taskCondition.notify_all();
+}
+
+void ThreadPool::Wait() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	_doneCondition.wait(lock, [this] { return _pendingTasks == 0; });
+}
+
+size_t ThreadPool::GetDefaultThreadCount() noexcept {
+	return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+}
+
+bool ThreadPool::PopTask(size_t worker, Task& task) {
+	auto& localTasks = _localTasks[worker];
+	if (!localTasks.empty()) {
+		task = std::move(localTasks.front());
+		localTasks.pop_front();
+		return true;
+	}
+	if (!_sharedTasks.empty()) {
+		task = std::move(_sharedTasks.front());
+		_sharedTasks.pop_front();
+		return true;
+	}
+	return false;
+}
+
+void ThreadPool::Run(size_t worker) {
+	for (;;) {
+		Task task;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_taskCondition.wait(lock, [&] { return _stop || !_localTasks[worker].empty() || !_sharedTasks.empty(); });
+			if (!PopTask(worker, task)) {
+				if (_stop)
+					return;
+				continue;
+			}
+		}
+
+		task();
+
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			if (--_pendingTasks == 0) {
+				_doneCondition.notify_all();
+			}
+		}
+	}
+}
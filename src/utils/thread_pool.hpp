@@ -0,0 +1,51 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+
+namespace plugify {
+	class ThreadPool {
+	public:
+		using Task = std::function<void()>;
+
+		/**
+		 * @param threadCount Number of workers, 0 to use hardware concurrency.
+		 */
+		explicit ThreadPool(size_t threadCount = 0);
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool(ThreadPool&&) = delete;
+		~ThreadPool();
+
+		size_t GetThreadCount() const noexcept {
+			return _workers.size();
+		}
+
+		// Any free worker picks the task up
+		void Enqueue(Task task);
+
+		// Task always runs on the same worker (index is wrapped by thread count)
+		void Enqueue(size_t worker, Task task);
+
+		// Blocks until every enqueued task is finished
+		void Wait();
+
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		ThreadPool& operator=(ThreadPool&&) = delete;
+
+		static size_t GetDefaultThreadCount() noexcept;
+
+	private:
+		bool PopTask(size_t worker, Task& task);
+		void Run(size_t worker);
+
+	private:
+		std::vector<std::thread> _workers;
+		std::vector<std::deque<Task>> _localTasks;
+		std::deque<Task> _sharedTasks;
+		std::mutex _mutex;
+		std::condition_variable _taskCondition;
+		std::condition_variable _doneCondition;
+		size_t _pendingTasks{ 0 };
+		bool _stop{ false };
+	};
+}
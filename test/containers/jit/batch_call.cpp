@@ -0,0 +1,121 @@
+#include <catch_amalgamated.hpp>
+
+#include <plugify/jit/call.hpp>
+
+#include <vector>
+
+// The batch stub is generated for the host, the signature below is spelled for x86-64
+#if defined(__x86_64__)
+
+namespace {
+
+int64_t g_calls = 0;
+
+int64_t Mul(int64_t a, int64_t b) {
+	++g_calls;
+	return a * b;
+}
+
+void Touch(int64_t a) {
+	g_calls += a;
+}
+
+asmjit::CallConvId GetCallConv() {
+#if defined(_WIN32)
+	return asmjit::CallConvId::kX64Windows;
+#else
+	return asmjit::CallConvId::kX64SystemV;
+#endif
+}
+
+} // namespace
+
+TEST_CASE("jit batch call", "[jit]") {
+	auto rt = std::make_shared<asmjit::JitRuntime>();
+
+	SECTION("returns a value per argument block") {
+		asmjit::FuncSignature sig(GetCallConv(), asmjit::FuncSignature::kNoVarArgs, asmjit::TypeId::kInt64);
+		sig.addArg(asmjit::TypeId::kInt64);
+		sig.addArg(asmjit::TypeId::kInt64);
+
+		plugify::JitCall call(rt);
+		plugify::MemAddr func = call.GetJitBatchFunc(sig, &Mul, false);
+		REQUIRE(func);
+
+		// a third slot per block checks that the stride is honoured
+		constexpr size_t kCount = 5;
+		constexpr size_t kStride = 3;
+		uint64_t params[kCount * kStride]{};
+		for (size_t i = 0; i < kCount; ++i) {
+			params[i * kStride] = i + 1;
+			params[i * kStride + 1] = i + 2;
+		}
+		plugify::JitCall::Return ret[kCount];
+
+		g_calls = 0;
+		func.RCast<plugify::JitCall::BatchFunc>()(params, kStride * sizeof(uint64_t), ret, kCount);
+		REQUIRE(g_calls == kCount);
+		for (size_t i = 0; i < kCount; ++i) {
+			REQUIRE(ret[i].GetReturn<int64_t>() == static_cast<int64_t>((i + 1) * (i + 2)));
+		}
+	}
+
+	SECTION("void target and empty batch") {
+		asmjit::FuncSignature sig(GetCallConv(), asmjit::FuncSignature::kNoVarArgs, asmjit::TypeId::kVoid);
+		sig.addArg(asmjit::TypeId::kInt64);
+
+		plugify::JitCall call(rt);
+		plugify::MemAddr func = call.GetJitBatchFunc(sig, &Touch, false);
+		REQUIRE(func);
+
+		const uint64_t params[] = { 1, 2, 3 };
+		auto batch = func.RCast<plugify::JitCall::BatchFunc>();
+
+		g_calls = 0;
+		batch(params, sizeof(uint64_t), nullptr, 0);
+		REQUIRE(g_calls == 0);
+
+		batch(params, sizeof(uint64_t), nullptr, std::size(params));
+		REQUIRE(g_calls == 6);
+	}
+}
+
+TEST_CASE("jit batch call benchmark", "[jit][benchmark]") {
+	auto rt = std::make_shared<asmjit::JitRuntime>();
+
+	asmjit::FuncSignature sig(GetCallConv(), asmjit::FuncSignature::kNoVarArgs, asmjit::TypeId::kInt64);
+	sig.addArg(asmjit::TypeId::kInt64);
+	sig.addArg(asmjit::TypeId::kInt64);
+
+	plugify::JitCall single(rt);
+	plugify::MemAddr singleFunc = single.GetJitFunc(sig, &Mul, plugify::JitCall::WaitType::None, false);
+	REQUIRE(singleFunc);
+
+	plugify::JitCall batch(rt);
+	plugify::MemAddr batchFunc = batch.GetJitBatchFunc(sig, &Mul, false);
+	REQUIRE(batchFunc);
+
+	constexpr size_t kCount = 1000;
+	constexpr size_t kStride = 2;
+	std::vector<uint64_t> params(kCount * kStride);
+	for (size_t i = 0; i < kCount; ++i) {
+		params[i * kStride] = i;
+		params[i * kStride + 1] = i + 1;
+	}
+	std::vector<plugify::JitCall::Return> ret(kCount);
+
+	BENCHMARK("1000 calls through CallingFunc") {
+		auto call = singleFunc.RCast<plugify::JitCall::CallingFunc>();
+		for (size_t i = 0; i < kCount; ++i) {
+			call(params.data() + i * kStride, &ret[i]);
+		}
+		return ret.back().GetReturn<int64_t>();
+	};
+
+	BENCHMARK("1000 calls through BatchFunc") {
+		batchFunc.RCast<plugify::JitCall::BatchFunc>()(params.data(), kStride * sizeof(uint64_t), ret.data(), kCount);
+		return ret.back().GetReturn<int64_t>();
+	};
+}
+
+#endif
@@ -0,0 +1,128 @@
+#include <catch_amalgamated.hpp>
+
+#include <plugify/jit/call.hpp>
+
+#include <vector>
+
+// The signatures below are spelled for x86-64
+#if defined(__x86_64__)
+
+namespace {
+
+int64_t Mad(int64_t a, int64_t b, int64_t c) {
+	return a * b + c;
+}
+
+asmjit::CallConvId GetCallConv() {
+#if defined(_WIN32)
+	return asmjit::CallConvId::kX64Windows;
+#else
+	return asmjit::CallConvId::kX64SystemV;
+#endif
+}
+
+asmjit::CallConvId GetForeignCallConv() {
+#if defined(_WIN32)
+	return asmjit::CallConvId::kX64SystemV;
+#else
+	return asmjit::CallConvId::kX64Windows;
+#endif
+}
+
+asmjit::FuncSignature GetMadSignature(asmjit::CallConvId callConv) {
+	asmjit::FuncSignature sig(callConv, asmjit::FuncSignature::kNoVarArgs, asmjit::TypeId::kInt64);
+	sig.addArg(asmjit::TypeId::kInt64);
+	sig.addArg(asmjit::TypeId::kInt64);
+	sig.addArg(asmjit::TypeId::kInt64);
+	return sig;
+}
+
+// Parameters as they were before the inline storage, one allocation per call
+struct VectorParameters {
+	explicit VectorParameters(size_t count) {
+		arguments.reserve(count);
+	}
+
+	template<typename T>
+	void AddArgument(T val) {
+		uint64_t& arg = arguments.emplace_back(0);
+		*(T*) &arg = val;
+	}
+
+	plugify::JitCall::Parameters::Data GetDataPtr() const noexcept {
+		return arguments.data();
+	}
+
+	std::vector<uint64_t> arguments;
+};
+
+template<typename P>
+int64_t CallMad(plugify::JitCall::CallingFunc func, int64_t a, int64_t b, int64_t c) {
+	P params(3);
+	params.AddArgument(a);
+	params.AddArgument(b);
+	params.AddArgument(c);
+	plugify::JitCall::Return ret;
+	func(params.GetDataPtr(), &ret);
+	return ret.GetReturn<int64_t>();
+}
+
+} // namespace
+
+TEST_CASE("jit > invoke", "[jit]") {
+	auto rt = std::make_shared<asmjit::JitRuntime>();
+
+	SECTION("matches the stub") {
+		plugify::JitCall call(rt);
+		plugify::MemAddr func = call.GetJitFunc(GetMadSignature(GetCallConv()), &Mad, plugify::JitCall::WaitType::None, false);
+		REQUIRE(func);
+		REQUIRE(call.IsInvocable());
+
+		auto stub = func.RCast<plugify::JitCall::CallingFunc>();
+		for (int64_t i = -3; i <= 3; ++i) {
+			REQUIRE(call.Invoke<int64_t>(i, i + 5, int64_t{7}) == CallMad<plugify::JitCall::Parameters>(stub, i, i + 5, 7));
+		}
+	}
+
+	SECTION("not invocable without a function") {
+		plugify::JitCall call(rt);
+		REQUIRE(!call.IsInvocable());
+	}
+
+	SECTION("not invocable with another calling convention") {
+		plugify::JitCall call(rt);
+		REQUIRE(call.GetJitFunc(GetMadSignature(GetForeignCallConv()), &Mad, plugify::JitCall::WaitType::None, false));
+		REQUIRE(!call.IsInvocable());
+	}
+
+	SECTION("not invocable with a hidden return") {
+		plugify::JitCall call(rt);
+		REQUIRE(call.GetJitFunc(GetMadSignature(GetCallConv()), &Mad, plugify::JitCall::WaitType::None, true));
+		REQUIRE(!call.IsInvocable());
+	}
+}
+
+TEST_CASE("jit > invoke benchmark", "[jit][benchmark]") {
+	auto rt = std::make_shared<asmjit::JitRuntime>();
+
+	plugify::JitCall call(rt);
+	plugify::MemAddr func = call.GetJitFunc(GetMadSignature(GetCallConv()), &Mad, plugify::JitCall::WaitType::None, false);
+	REQUIRE(func);
+	REQUIRE(call.IsInvocable());
+	auto stub = func.RCast<plugify::JitCall::CallingFunc>();
+
+	int64_t a = 3;
+	BENCHMARK("std::vector parameters") {
+		return CallMad<VectorParameters>(stub, a, 4, 5);
+	};
+
+	BENCHMARK("inline parameters") {
+		return CallMad<plugify::JitCall::Parameters>(stub, a, 4, 5);
+	};
+
+	BENCHMARK("Invoke") {
+		return call.Invoke<int64_t>(a, int64_t{4}, int64_t{5});
+	};
+}
+
+#endif
@@ -0,0 +1,39 @@
+#include <catch_amalgamated.hpp>
+
+#include <plugify/jit/call.hpp>
+#include <plugify/numerics.hpp>
+
+TEST_CASE("jit > call parameters", "[jit]") {
+	SECTION("grows past the inline storage") {
+		constexpr size_t kCount = plugify::JitCall::Parameters::kInlineCapacity * 3;
+
+		plugify::JitCall::Parameters params(4);
+		for (size_t i = 0; i < kCount; ++i) {
+			params.AddArgument(static_cast<int64_t>(i * 3));
+		}
+
+		auto data = params.GetDataPtr();
+		for (size_t i = 0; i < kCount; ++i) {
+			REQUIRE(data[i] == i * 3);
+		}
+	}
+
+	SECTION("wide arguments counted by parameters") {
+		// every vec4 takes two slots, so the parameters count alone would not be enough
+		constexpr size_t kCount = plugify::JitCall::Parameters::kInlineCapacity;
+
+		plugify::JitCall::Parameters params(kCount);
+		for (size_t i = 0; i < kCount; ++i) {
+			float f = static_cast<float>(i);
+			params.AddArgument(plg::vec4{ { { f, f + 1.0f, f + 2.0f, f + 3.0f } } });
+		}
+
+		auto data = params.GetDataPtr();
+		for (size_t i = 0; i < kCount; ++i) {
+			plg::vec4 v;
+			std::memcpy(&v, data + i * 2, sizeof(v));
+			float f = static_cast<float>(i);
+			REQUIRE(v == plg::vec4{ { { f, f + 1.0f, f + 2.0f, f + 3.0f } } });
+		}
+	}
+}
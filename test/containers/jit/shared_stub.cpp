@@ -0,0 +1,115 @@
+#include <catch_amalgamated.hpp>
+
+#include <plugify/jit/call.hpp>
+#include <plugify/jit/callback.hpp>
+#include <plugify/jit/stub_cache.hpp>
+
+#include <optional>
+
+// Shared stubs are only generated on 64-bit hosts, the signature below is spelled for x86-64
+#if defined(__x86_64__)
+
+namespace {
+
+int64_t Add(int64_t a, int64_t b) {
+	return a + b;
+}
+
+int64_t Mul(int64_t a, int64_t b) {
+	return a * b;
+}
+
+asmjit::FuncSignature GetSignature() {
+#if defined(_WIN32)
+	asmjit::FuncSignature sig(asmjit::CallConvId::kX64Windows, asmjit::FuncSignature::kNoVarArgs, asmjit::TypeId::kInt64);
+#else
+	asmjit::FuncSignature sig(asmjit::CallConvId::kX64SystemV, asmjit::FuncSignature::kNoVarArgs, asmjit::TypeId::kInt64);
+#endif
+	sig.addArg(asmjit::TypeId::kInt64);
+	sig.addArg(asmjit::TypeId::kInt64);
+	return sig;
+}
+
+int64_t Call(plugify::MemAddr func, int64_t a, int64_t b) {
+	plugify::JitCall::Parameters params(2);
+	params.AddArgument(a);
+	params.AddArgument(b);
+	plugify::JitCall::Return ret;
+	func.RCast<plugify::JitCall::CallingFunc>()(params.GetDataPtr(), &ret);
+	return ret.GetReturn<int64_t>();
+}
+
+// Handler comes from the thunk slot, data is added to tell the two callbacks apart
+void AddHandler(plugify::MethodHandle, plugify::MemAddr data, const plugify::JitCallback::Parameters* params, size_t, const plugify::JitCallback::Return* ret) {
+	ret->SetReturn(Add(params->GetArgument<int64_t>(0), params->GetArgument<int64_t>(1)) + *data.RCast<int64_t*>());
+}
+
+void MulHandler(plugify::MethodHandle, plugify::MemAddr data, const plugify::JitCallback::Parameters* params, size_t, const plugify::JitCallback::Return* ret) {
+	ret->SetReturn(Mul(params->GetArgument<int64_t>(0), params->GetArgument<int64_t>(1)) + *data.RCast<int64_t*>());
+}
+
+} // namespace
+
+TEST_CASE("jit > shared stubs", "[jit]") {
+	auto rt = std::make_shared<asmjit::JitRuntime>();
+	auto sig = GetSignature();
+
+	std::optional<plugify::JitCall> add(rt);
+	std::optional<plugify::JitCall> mul(rt);
+	plugify::MemAddr addFunc = add->GetJitFunc(sig, &Add, plugify::JitCall::WaitType::None, false);
+	plugify::MemAddr mulFunc = mul->GetJitFunc(sig, &Mul, plugify::JitCall::WaitType::None, false);
+	REQUIRE(addFunc);
+	REQUIRE(mulFunc);
+
+	// one stub for the signature, every target gets its own thunk
+	REQUIRE(add->GetStub());
+	REQUIRE(add->GetStub() == mul->GetStub());
+	REQUIRE(addFunc != mulFunc);
+
+	auto stats = plugify::JitStubCache::GetStats(rt);
+	REQUIRE(stats.compiled == 1);
+	REQUIRE(stats.shared == 1);
+
+	REQUIRE(Call(addFunc, 6, 7) == 13);
+	REQUIRE(Call(mulFunc, 6, 7) == 42);
+
+	// the stub outlives the first owner
+	add.reset();
+	REQUIRE(plugify::JitStubCache::GetStats(rt).shared == 1);
+	REQUIRE(Call(mulFunc, 3, 5) == 15);
+
+	mul.reset();
+	REQUIRE(plugify::JitStubCache::GetStats(rt).shared == 0);
+}
+
+TEST_CASE("jit > shared callback stubs", "[jit]") {
+	auto rt = std::make_shared<asmjit::JitRuntime>();
+	auto sig = GetSignature();
+
+	int64_t addBias = 100;
+	int64_t mulBias = 1000;
+
+	std::optional<plugify::JitCallback> add(rt);
+	std::optional<plugify::JitCallback> mul(rt);
+	plugify::MemAddr addFunc = add->GetJitFunc(sig, {}, &AddHandler, &addBias, false);
+	plugify::MemAddr mulFunc = mul->GetJitFunc(sig, {}, &MulHandler, &mulBias, false);
+	REQUIRE(addFunc);
+	REQUIRE(mulFunc);
+
+	// handler and data only live in the slot of each thunk, so the stub is the same
+	REQUIRE(add->GetStub());
+	REQUIRE(add->GetStub() == mul->GetStub());
+	REQUIRE(addFunc != mulFunc);
+	REQUIRE(plugify::JitStubCache::GetStats(rt).shared == 1);
+
+	REQUIRE(addFunc.RCast<int64_t(*)(int64_t, int64_t)>()(6, 7) == 113);
+	REQUIRE(mulFunc.RCast<int64_t(*)(int64_t, int64_t)>()(6, 7) == 1042);
+
+	add.reset();
+	REQUIRE(mulFunc.RCast<int64_t(*)(int64_t, int64_t)>()(3, 5) == 1015);
+
+	mul.reset();
+	REQUIRE(plugify::JitStubCache::GetStats(rt).shared == 0);
+}
+
+#endif
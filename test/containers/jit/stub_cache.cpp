@@ -0,0 +1,109 @@
+#include <catch_amalgamated.hpp>
+
+#include <plugify/jit/call.hpp>
+#include <plugify/jit/stub_cache.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+// Shared stubs are only generated on 64-bit hosts, the signature below is spelled for x86-64
+#if defined(__x86_64__)
+
+namespace fs = std::filesystem;
+
+namespace {
+
+int64_t Sub(int64_t a, int64_t b) {
+	return a - b;
+}
+
+asmjit::FuncSignature GetSubSignature() {
+#if defined(_WIN32)
+	asmjit::FuncSignature sig(asmjit::CallConvId::kX64Windows, asmjit::FuncSignature::kNoVarArgs, asmjit::TypeId::kInt64);
+#else
+	asmjit::FuncSignature sig(asmjit::CallConvId::kX64SystemV, asmjit::FuncSignature::kNoVarArgs, asmjit::TypeId::kInt64);
+#endif
+	sig.addArg(asmjit::TypeId::kInt64);
+	sig.addArg(asmjit::TypeId::kInt64);
+	return sig;
+}
+
+int64_t CallSub(plugify::MemAddr func, int64_t a, int64_t b) {
+	plugify::JitCall::Parameters params(2);
+	params.AddArgument(a);
+	params.AddArgument(b);
+	plugify::JitCall::Return ret;
+	func.RCast<plugify::JitCall::CallingFunc>()(params.GetDataPtr(), &ret);
+	return ret.GetReturn<int64_t>();
+}
+
+} // namespace
+
+TEST_CASE("jit > stub cache", "[jit]") {
+	auto path = fs::temp_directory_path() / plugify::JitStubCache::kFileName;
+	fs::remove(path);
+
+	auto sig = GetSubSignature();
+
+	auto rt = std::make_shared<asmjit::JitRuntime>();
+	{
+		plugify::JitCall call(rt);
+		REQUIRE(call.GetJitFunc(sig, &Sub, plugify::JitCall::WaitType::None, false));
+	}
+	auto saved = plugify::JitStubCache::GetStats(rt);
+	REQUIRE(saved.compiled == 1);
+	REQUIRE(plugify::JitStubCache::Save(rt, path));
+
+	SECTION("round trip") {
+		// a fresh runtime stands in for the next start of the process
+		auto fresh = std::make_shared<asmjit::JitRuntime>();
+		REQUIRE(plugify::JitStubCache::Load(fresh, path));
+
+		plugify::JitCall call(fresh);
+		plugify::MemAddr func = call.GetJitFunc(sig, &Sub, plugify::JitCall::WaitType::None, false);
+		REQUIRE(func);
+		REQUIRE(CallSub(func, 10, 3) == 7);
+
+		auto stats = plugify::JitStubCache::GetStats(fresh);
+		REQUIRE(stats.compiled == 0);
+		REQUIRE(stats.loaded == 1);
+		REQUIRE(stats.savedTime == saved.compileTime);
+	}
+
+	SECTION("damaged image is rejected") {
+		std::vector<char> bytes;
+		{
+			std::ifstream is(path, std::ios::binary);
+			bytes.assign(std::istreambuf_iterator<char>(is), {});
+		}
+		// last byte of the machine code, right before the image hash
+		REQUIRE(bytes.size() > sizeof(uint64_t));
+		bytes[bytes.size() - sizeof(uint64_t) - 1] ^= 0x5A;
+		{
+			std::ofstream os(path, std::ios::binary | std::ios::trunc);
+			os.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+		}
+
+		auto fresh = std::make_shared<asmjit::JitRuntime>();
+		REQUIRE(!plugify::JitStubCache::Load(fresh, path));
+
+		plugify::JitCall call(fresh);
+		plugify::MemAddr func = call.GetJitFunc(sig, &Sub, plugify::JitCall::WaitType::None, false);
+		REQUIRE(func);
+		REQUIRE(CallSub(func, 10, 3) == 7);
+		REQUIRE(plugify::JitStubCache::GetStats(fresh).loaded == 0);
+	}
+
+	SECTION("truncated file is rejected") {
+		fs::resize_file(path, fs::file_size(path) / 2);
+
+		auto fresh = std::make_shared<asmjit::JitRuntime>();
+		REQUIRE(!plugify::JitStubCache::Load(fresh, path));
+	}
+
+	fs::remove(path);
+}
+
+#endif
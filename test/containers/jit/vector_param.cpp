@@ -0,0 +1,181 @@
+#include <catch_amalgamated.hpp>
+
+#include <plugify/jit/call.hpp>
+#include <plugify/jit/callback.hpp>
+#include <plugify/numerics.hpp>
+
+// Vectors are passed by value in xmm registers only by the System V x86-64 ABI
+#if defined(__x86_64__) && !defined(_WIN32)
+
+namespace {
+
+plg::vec2 Add(plg::vec2 a, plg::vec2 b) { return { { { a.x + b.x, a.y + b.y } } }; }
+plg::vec3 Add(plg::vec3 a, plg::vec3 b) { return { { { a.x + b.x, a.y + b.y, a.z + b.z } } }; }
+plg::vec4 Add(plg::vec4 a, plg::vec4 b) { return { { { a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w } } }; }
+
+template<typename T>
+constexpr asmjit::TypeId GetVectorTypeId() {
+	// an 8 byte struct takes one eightbyte, wider ones take two
+	return sizeof(T) == sizeof(uint64_t) ? asmjit::TypeId::kFloat64 : asmjit::TypeId::kFloat32x4;
+}
+
+template<typename T>
+asmjit::FuncSignature GetAddSignature() {
+	asmjit::FuncSignature sig(asmjit::CallConvId::kX64SystemV, asmjit::FuncSignature::kNoVarArgs, GetVectorTypeId<T>());
+	sig.addArg(GetVectorTypeId<T>());
+	sig.addArg(GetVectorTypeId<T>());
+	return sig;
+}
+
+template<typename T>
+constexpr size_t kSlots = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+template<typename T>
+T Call(const std::shared_ptr<asmjit::JitRuntime>& rt, T a, T b) {
+	plugify::JitCall call(rt);
+	T (*target)(T, T) = &Add;
+	plugify::MemAddr func = call.GetJitFunc(GetAddSignature<T>(), target, plugify::JitCall::WaitType::None, false);
+	REQUIRE(func);
+
+	plugify::JitCall::Parameters params(2);
+	params.AddArgument(a);
+	params.AddArgument(b);
+	plugify::JitCall::Return ret;
+	func.RCast<plugify::JitCall::CallingFunc>()(params.GetDataPtr(), &ret);
+	return ret.GetReturn<T>();
+}
+
+template<typename T>
+void AddHandler(plugify::MethodHandle, plugify::MemAddr data, const plugify::JitCallback::Parameters* params, size_t count, const plugify::JitCallback::Return* ret) {
+	// exceptions can't unwind through generated code, so results are checked by the caller
+	*data.RCast<size_t*>() = count;
+	ret->SetReturn(Add(params->GetArgument<T>(0), params->GetArgument<T>(kSlots<T>)));
+}
+
+template<typename T>
+T Callback(const std::shared_ptr<asmjit::JitRuntime>& rt, T a, T b, size_t& count) {
+	plugify::JitCallback callback(rt);
+	plugify::MemAddr func = callback.GetJitFunc(GetAddSignature<T>(), {}, &AddHandler<T>, &count, false);
+	REQUIRE(func);
+	return func.RCast<T(*)(T, T)>()(a, b);
+}
+
+// Seven floats leave only xmm7, so the vector goes to the stack and xmm7 is left to the trailing float
+constexpr size_t kSpilledFloats = 7;
+
+float Sum(float a0, float a1, float a2, float a3, float a4, float a5, float a6, plg::vec4 v) {
+	return a0 + a1 * 2 + a2 * 3 + a3 * 4 + a4 * 5 + a5 * 6 + a6 * 7 + v.x * 10 + v.y * 20 + v.z * 30 + v.w * 40;
+}
+
+float Sum(float a0, float a1, float a2, float a3, float a4, float a5, float a6, plg::vec4 v, float f) {
+	return Sum(a0, a1, a2, a3, a4, a5, a6, v) + f * 100;
+}
+
+asmjit::FuncSignature GetSumSignature(bool trailing) {
+	asmjit::FuncSignature sig(asmjit::CallConvId::kX64SystemV, asmjit::FuncSignature::kNoVarArgs, asmjit::TypeId::kFloat32);
+	for (size_t i = 0; i < kSpilledFloats; ++i) {
+		sig.addArg(asmjit::TypeId::kFloat32);
+	}
+	sig.addArg(asmjit::TypeId::kFloat32x4);
+	if (trailing) {
+		sig.addArg(asmjit::TypeId::kFloat32);
+	}
+	return sig;
+}
+
+float CallSum(const std::shared_ptr<asmjit::JitRuntime>& rt, plugify::MemAddr target, bool trailing, plg::vec4 v, float f) {
+	plugify::JitCall call(rt);
+	plugify::MemAddr func = call.GetJitFunc(GetSumSignature(trailing), target, plugify::JitCall::WaitType::None, false);
+	REQUIRE(func);
+
+	plugify::JitCall::Parameters params(kSpilledFloats + 2);
+	for (size_t i = 0; i < kSpilledFloats; ++i) {
+		params.AddArgument(static_cast<float>(i + 1));
+	}
+	params.AddArgument(v);
+	if (trailing) {
+		params.AddArgument(f);
+	}
+	plugify::JitCall::Return ret;
+	func.RCast<plugify::JitCall::CallingFunc>()(params.GetDataPtr(), &ret);
+	return ret.GetReturn<float>();
+}
+
+void SumHandler(plugify::MethodHandle, plugify::MemAddr data, const plugify::JitCallback::Parameters* params, size_t count, const plugify::JitCallback::Return* ret) {
+	*data.RCast<size_t*>() = count;
+	float sum = 0;
+	for (size_t i = 0; i < kSpilledFloats; ++i) {
+		sum += params->GetArgument<float>(i) * static_cast<float>(i + 1);
+	}
+	auto v = params->GetArgument<plg::vec4>(kSpilledFloats);
+	sum += v.x * 10 + v.y * 20 + v.z * 30 + v.w * 40;
+	// the vector takes two slots
+	if (count > kSpilledFloats + 2) {
+		sum += params->GetArgument<float>(kSpilledFloats + 2) * 100;
+	}
+	ret->SetReturn(sum);
+}
+
+} // namespace
+
+TEST_CASE("jit > vector parameters", "[jit]") {
+	auto rt = std::make_shared<asmjit::JitRuntime>();
+
+	SECTION("vec2") {
+		plg::vec2 a{ { { 1.0f, 2.0f } } };
+		plg::vec2 b{ { { 10.0f, 20.0f } } };
+		REQUIRE(Call(rt, a, b) == Add(a, b));
+
+		size_t count = 0;
+		REQUIRE(Callback(rt, a, b, count) == Add(a, b));
+		REQUIRE(count == 2);
+	}
+
+	SECTION("vec3") {
+		plg::vec3 a{ { { 1.0f, 2.0f, 3.0f } } };
+		plg::vec3 b{ { { 10.0f, 20.0f, 30.0f } } };
+		REQUIRE(Call(rt, a, b) == Add(a, b));
+
+		size_t count = 0;
+		REQUIRE(Callback(rt, a, b, count) == Add(a, b));
+		REQUIRE(count == 4);
+	}
+
+	SECTION("vec4") {
+		plg::vec4 a{ { { 1.0f, 2.0f, 3.0f, 4.0f } } };
+		plg::vec4 b{ { { 10.0f, 20.0f, 30.0f, 40.0f } } };
+		REQUIRE(Call(rt, a, b) == Add(a, b));
+
+		size_t count = 0;
+		REQUIRE(Callback(rt, a, b, count) == Add(a, b));
+		REQUIRE(count == 4);
+	}
+
+	SECTION("vec4 after seven floats") {
+		plg::vec4 v{ { { 1.0f, 2.0f, 3.0f, 4.0f } } };
+		float (*target)(float, float, float, float, float, float, float, plg::vec4) = &Sum;
+		REQUIRE(CallSum(rt, target, false, v, 0.0f) == Sum(1, 2, 3, 4, 5, 6, 7, v));
+
+		size_t count = 0;
+		plugify::JitCallback callback(rt);
+		plugify::MemAddr func = callback.GetJitFunc(GetSumSignature(false), {}, &SumHandler, &count, false);
+		REQUIRE(func);
+		REQUIRE(func.RCast<decltype(target)>()(1, 2, 3, 4, 5, 6, 7, v) == Sum(1, 2, 3, 4, 5, 6, 7, v));
+		REQUIRE(count == kSpilledFloats + 2);
+	}
+
+	SECTION("float after a spilled vec4") {
+		plg::vec4 v{ { { 1.0f, 2.0f, 3.0f, 4.0f } } };
+		float (*target)(float, float, float, float, float, float, float, plg::vec4, float) = &Sum;
+		REQUIRE(CallSum(rt, target, true, v, 2.0f) == Sum(1, 2, 3, 4, 5, 6, 7, v, 2));
+
+		size_t count = 0;
+		plugify::JitCallback callback(rt);
+		plugify::MemAddr func = callback.GetJitFunc(GetSumSignature(true), {}, &SumHandler, &count, false);
+		REQUIRE(func);
+		REQUIRE(func.RCast<decltype(target)>()(1, 2, 3, 4, 5, 6, 7, v, 2) == Sum(1, 2, 3, 4, 5, 6, 7, v, 2));
+		REQUIRE(count == kSpilledFloats + 3);
+	}
+}
+
+#endif
@@ -0,0 +1,105 @@
+#include <catch_amalgamated.hpp>
+
+#include "plugin_manager/fixture.hpp"
+
+#include <miniz.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Peak memory is read from procfs, packages are fetched through curl from a file:// url
+#if PLUGIFY_DOWNLOADER && defined(__linux__)
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Mirrors PackageManager::kExtractBufferSize
+constexpr size_t kExtractBufferSize = 1 << 20;
+constexpr size_t kWorkerCount = 2;
+constexpr size_t kEntryCount = 4;
+constexpr size_t kEntrySize = 64 << 20;
+
+bool WriteArchive(const fs::path& path, std::string_view descriptor) {
+	mz_zip_archive zipArchive{};
+	if (!mz_zip_writer_init_file(&zipArchive, path.c_str(), 0))
+		return false;
+
+	bool result = mz_zip_writer_add_mem(&zipArchive, "big.pplugin", descriptor.data(), descriptor.size(), MZ_BEST_SPEED);
+
+	{
+		// Zeros compress to almost nothing, so the archive is small while every entry inflates to kEntrySize
+		std::vector<char> data(kEntrySize);
+		for (size_t i = 0; i < kEntryCount && result; ++i) {
+			auto name = "bin/data_" + std::to_string(i) + ".bin";
+			result = mz_zip_writer_add_mem(&zipArchive, name.c_str(), data.data(), data.size(), MZ_BEST_SPEED);
+		}
+	}
+
+	result = result && mz_zip_writer_finalize_archive(&zipArchive);
+	mz_zip_writer_end(&zipArchive);
+	return result;
+}
+
+// Value of a "Name: 1234 kB" line of /proc/self/status in bytes
+uint64_t ReadStatus(std::string_view name) {
+	std::ifstream is("/proc/self/status");
+	std::string line;
+	while (std::getline(is, line)) {
+		if (line.starts_with(name) && line.size() > name.size() && line[name.size()] == ':')
+			return std::stoull(line.substr(name.size() + 1)) * 1024;
+	}
+	return 0;
+}
+
+// Sets the peak resident set size back to the current one
+bool ResetPeakMemory() {
+	std::ofstream os("/proc/self/clear_refs");
+	os << "5";
+	os.flush();
+	return os.good() && ReadStatus("VmHWM") != 0;
+}
+
+} // namespace
+
+TEST_CASE("package manager > extract large package", "[package_manager]") {
+	PluginTestEnvironment env("plugify_extract", R"("workerThreads": 2)");
+
+	auto archivePath = env.GetRootDir() / "big.zip";
+	REQUIRE(WriteArchive(archivePath, GetPluginDescriptor("Big")));
+
+	std::string manifest = R"({ "content": { "big": { "name": "big", "type": "plugin", "versions": [ { "version": "1.0.0", "download": "file://)";
+	manifest += archivePath.generic_string();
+	manifest += R"(" } ] } } })";
+	WriteText(env.GetBaseDir() / "big.pmanifest", manifest);
+
+	env.Start();
+	auto packageManager = env.GetPackageManager();
+
+	if (!ResetPeakMemory()) {
+		SKIP("Peak memory usage can not be reset on this system");
+	}
+	uint64_t before = ReadStatus("VmRSS");
+
+	packageManager->InstallAllPackages(fs::path("big.pmanifest"), false);
+
+	uint64_t peak = ReadStatus("VmHWM");
+
+	REQUIRE(packageManager->FindLocalPackage("big"));
+	for (size_t i = 0; i < kEntryCount; ++i) {
+		auto path = env.GetPluginDir("big") / "bin" / ("data_" + std::to_string(i) + ".bin");
+		REQUIRE(fs::file_size(path) == kEntrySize);
+	}
+
+	// Every worker keeps one buffer and a small inflate state, the rest is slack for the downloader and logging.
+	// Holding a whole entry would take kEntrySize on its own.
+	constexpr uint64_t kBound = kWorkerCount * kExtractBufferSize * 2 + (16 << 20);
+	static_assert(kBound < kEntrySize);
+	INFO("Peak memory grew by " << (peak - before) / 1024 << " KiB");
+	REQUIRE(peak - before < kBound);
+}
+
+#endif
@@ -0,0 +1,36 @@
+#include <catch_amalgamated.hpp>
+
+#include "plugin_manager/fixture.hpp"
+
+#include <string>
+
+// Repositories are served by curl from file:// urls, so no server is needed
+#if PLUGIFY_DOWNLOADER && !defined(_WIN32)
+
+TEST_CASE("package manager > wait for requests benchmark", "[package_manager][benchmark]") {
+	auto count = GENERATE(1, 500);
+
+	PluginTestEnvironment env("plugify_requests_" + std::to_string(count));
+	auto& plug = env.Start();
+	auto packageManager = env.GetPackageManager();
+
+	// One manifest per repository, each with its own package, so every request is a separate transfer
+	for (int i = 0; i < count; ++i) {
+		auto name = "package_" + std::to_string(i);
+		auto path = env.GetRootDir() / "repositories" / (name + ".json");
+		WriteText(path, R"({ "content": { ")" + name + R"(": { "name": ")" + name + R"(", "type": "plugin", "versions": [ { "version": "1.0.0", "download": "https://example.com/)" + name + R"(.zip" } ] } } })");
+		REQUIRE(plug.AddRepository("file://" + path.generic_string()));
+	}
+
+	REQUIRE(packageManager->Reload());
+	REQUIRE(packageManager->GetRemotePackages().size() == static_cast<size_t>(count));
+	REQUIRE(packageManager->FindRemotePackage("package_" + std::to_string(count - 1)));
+
+	// Reload fetches every repository and blocks in WaitForAllRequests until the last one is done,
+	// with a single request the time is mostly the latency of waking up the waiting thread
+	BENCHMARK("Reload with " + std::to_string(count) + " repositories") {
+		return packageManager->Reload();
+	};
+}
+
+#endif
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <catch_amalgamated.hpp>
+
+#include <plugify/log.hpp>
+#include <plugify/package.hpp>
+#include <plugify/package_manager.hpp>
+#include <plugify/plugify.hpp>
+#include <plugify/plugin_manager.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+inline void WriteText(const std::filesystem::path& path, std::string_view text) {
+	std::filesystem::create_directories(path.parent_path());
+	std::ofstream os(path, std::ios::binary | std::ios::trunc);
+	os << text;
+}
+
+inline std::string GetPluginDescriptor(std::string_view friendlyName, const std::vector<std::string>& dependencies = {}) {
+	std::string json = R"({ "fileVersion": 1, "version": "1.0.0", "friendlyName": ")";
+	json += friendlyName;
+	json += R"(", "entryPoint": "bin/plugin", "languageModule": { "name": "test" })";
+	if (!dependencies.empty()) {
+		json += R"(, "dependencies": [ )";
+		for (size_t i = 0; i < dependencies.size(); ++i) {
+			if (i != 0) {
+				json += ", ";
+			}
+			json += R"({ "name": ")";
+			json += dependencies[i];
+			json += R"(" })";
+		}
+		json += " ]";
+	}
+	json += " }";
+	return json;
+}
+
+// Base directory with the test language module, plugins are written by the test before Start
+class PluginTestEnvironment {
+public:
+	explicit PluginTestEnvironment(std::string_view name, std::string_view config = {}) : _root(std::filesystem::temp_directory_path() / name) {
+		std::filesystem::remove_all(_root);
+
+		std::string json = R"({ "baseDir": "base", "repositories": [])";
+		if (!config.empty()) {
+			json += ", ";
+			json += config;
+		}
+		json += " }";
+		WriteText(_root / "plugify.pconfig", json);
+
+		// Test module is built as a separate library, plugify finds it by the module name
+		auto moduleDir = GetBaseDir() / "modules" / "test_lang";
+		WriteText(moduleDir / "test_lang.pmodule", R"({ "fileVersion": 1, "version": "1.0.0", "friendlyName": "Test language module", "language": "test" })");
+		std::filesystem::path modulePath(TEST_MODULE_PATH);
+		std::filesystem::create_directories(moduleDir / "bin");
+		std::filesystem::copy_file(modulePath, moduleDir / "bin" / modulePath.filename(), std::filesystem::copy_options::overwrite_existing);
+	}
+
+	~PluginTestEnvironment() {
+		if (_plugify) {
+			_plugify->Terminate();
+			if (_logger) {
+				_plugify->SetLogger(nullptr);
+			}
+		}
+		std::error_code ec;
+		std::filesystem::remove_all(_root, ec);
+	}
+
+	PluginTestEnvironment(const PluginTestEnvironment&) = delete;
+	PluginTestEnvironment& operator=(const PluginTestEnvironment&) = delete;
+
+	std::filesystem::path GetRootDir() const { return _root; }
+
+	std::filesystem::path GetBaseDir() const { return _root / "base"; }
+
+	std::filesystem::path GetPluginDir(std::string_view name) const { return GetBaseDir() / "plugins" / name; }
+
+	std::filesystem::path AddPlugin(std::string_view name, std::string_view descriptor) {
+		auto pluginDir = GetPluginDir(name);
+		WriteText(pluginDir / (std::string(name) + ".pplugin"), descriptor);
+		return pluginDir;
+	}
+
+	// Only the descriptor is written, such a module can be looked up but not loaded
+	void AddModule(std::string_view name, std::string_view language) {
+		std::string json = R"({ "fileVersion": 1, "version": "1.0.0", "friendlyName": ")";
+		json += name;
+		json += R"(", "language": ")";
+		json += language;
+		json += R"(" })";
+		WriteText(GetBaseDir() / "modules" / name / (std::string(name) + ".pmodule"), json);
+	}
+
+	// Initializes plugify, the package manager and the plugin manager
+	plugify::IPlugify& Start(std::shared_ptr<plugify::ILogger> logger = nullptr) {
+		_plugify = plugify::MakePlugify();
+		if (logger) {
+			// logger is global, so it is reset again when the environment goes away
+			_plugify->SetLogger(std::move(logger));
+			_logger = true;
+		}
+		REQUIRE(_plugify->Initialize(_root));
+		{
+			auto packageManager = _plugify->GetPackageManager().lock();
+			REQUIRE(packageManager);
+			REQUIRE(packageManager->Initialize());
+		}
+		auto pluginManager = _plugify->GetPluginManager().lock();
+		REQUIRE(pluginManager);
+		REQUIRE(pluginManager->Initialize());
+		return *_plugify;
+	}
+
+	std::shared_ptr<plugify::IPackageManager> GetPackageManager() const {
+		return _plugify->GetPackageManager().lock();
+	}
+
+	std::shared_ptr<plugify::IPluginManager> GetPluginManager() const {
+		return _plugify->GetPluginManager().lock();
+	}
+
+private:
+	std::filesystem::path _root;
+	std::shared_ptr<plugify::IPlugify> _plugify;
+	bool _logger{};
+};
@@ -0,0 +1,116 @@
+#include <catch_amalgamated.hpp>
+
+#include <plugify/plugin.hpp>
+
+#include "fixture.hpp"
+#include "test_module.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <thread>
+
+namespace fs = std::filesystem;
+using namespace std::chrono_literals;
+
+namespace {
+
+// Plugin manager ticks until the predicate holds, returns the time it took
+template<typename F>
+std::chrono::steady_clock::duration TickUntil(plugify::IPlugify& plug, std::chrono::steady_clock::duration timeout, F&& predicate) {
+	auto start = std::chrono::steady_clock::now();
+	while (!predicate() && std::chrono::steady_clock::now() - start < timeout) {
+		plug.Update();
+		std::this_thread::sleep_for(1ms);
+	}
+	return std::chrono::steady_clock::now() - start;
+}
+
+double ToMilliseconds(std::chrono::steady_clock::duration duration) {
+	return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+} // namespace
+
+TEST_CASE("plugin manager > hot reload", "[plugin_manager]") {
+	PluginTestEnvironment env("plugify_hot_reload", R"("hotReload": true)");
+
+	auto sampleDir = env.AddPlugin("sample", GetPluginDescriptor("Sample"));
+	WriteText(sampleDir / "bin" / "plugin", "v1");
+	env.AddPlugin("dependent", GetPluginDescriptor("Dependent", { "sample" }));
+	env.AddPlugin("other", GetPluginDescriptor("Other"));
+
+	auto& plug = env.Start();
+	auto pluginManager = env.GetPluginManager();
+
+	auto getData = [&](std::string_view name) -> TestPluginData& {
+		auto plugin = pluginManager->FindPlugin(name);
+		REQUIRE(plugin);
+		REQUIRE(plugin.GetState() == plugify::PluginState::Running);
+		return *plugin.GetData().RCast<TestPluginData*>();
+	};
+
+	auto& sample = getData("sample");
+	auto& dependent = getData("dependent");
+	auto& other = getData("other");
+	plug.Update();
+	REQUIRE(other.updates == 1);
+
+	SECTION("manual reload") {
+		WriteText(sampleDir / "sample.pplugin", GetPluginDescriptor("Sample v2"));
+
+		auto start = std::chrono::steady_clock::now();
+		REQUIRE(pluginManager->ReloadPlugin("sample"));
+		WARN("ReloadPlugin took " << ToMilliseconds(std::chrono::steady_clock::now() - start) << "ms");
+
+		REQUIRE(pluginManager->FindPlugin("sample").GetFriendlyName() == "Sample v2");
+		REQUIRE(sample.ends == 1);
+		REQUIRE(sample.loads == 2);
+		REQUIRE(sample.starts == 2);
+		REQUIRE(dependent.ends == 1);
+		REQUIRE(dependent.loads == 2);
+		REQUIRE(other.ends == 0);
+		REQUIRE(other.loads == 1);
+
+		BENCHMARK("ReloadPlugin with one dependent") {
+			return pluginManager->ReloadPlugin("sample");
+		};
+	}
+
+	SECTION("descriptor change") {
+		WriteText(sampleDir / "sample.pplugin", GetPluginDescriptor("Sample v2"));
+
+		uint64_t updates = other.updates;
+		auto latency = TickUntil(plug, 5s, [&] { return sample.loads == 2; });
+		WARN("Descriptor change was picked up in " << ToMilliseconds(latency) << "ms");
+
+		REQUIRE(sample.loads == 2);
+		REQUIRE(dependent.loads == 2);
+		REQUIRE(pluginManager->FindPlugin("sample").GetFriendlyName() == "Sample v2");
+		// unrelated plugin kept ticking the whole time
+		REQUIRE(other.loads == 1);
+		REQUIRE(other.updates > updates);
+		CHECK(latency < 2s);
+	}
+
+	SECTION("binary change") {
+		WriteText(sampleDir / "bin" / "plugin", "v2");
+
+		auto latency = TickUntil(plug, 5s, [&] { return sample.loads == 2; });
+		WARN("Binary change was picked up in " << ToMilliseconds(latency) << "ms");
+
+		REQUIRE(sample.loads == 2);
+		REQUIRE(other.loads == 1);
+		CHECK(latency < 2s);
+	}
+
+	SECTION("other files are ignored") {
+		WriteText(sampleDir / "config.json", "{}");
+		WriteText(sampleDir / "logs" / "plugin.log", "started");
+
+		// longer than the settle time and the poll interval together
+		TickUntil(plug, 1500ms, [] { return false; });
+
+		REQUIRE(sample.loads == 1);
+		REQUIRE(other.loads == 1);
+	}
+}
@@ -0,0 +1,58 @@
+#include <catch_amalgamated.hpp>
+
+#include <plugify/module.hpp>
+#include <plugify/plugin.hpp>
+
+#include "fixture.hpp"
+
+#include <string>
+
+TEST_CASE("plugin manager > lookup benchmark", "[plugin_manager][benchmark]") {
+	auto count = GENERATE(10, 100, 1000);
+
+	PluginTestEnvironment env("plugify_lookup_" + std::to_string(count));
+	for (int i = 0; i < count; ++i) {
+		auto name = "plugin_" + std::to_string(i);
+		env.AddPlugin(name, GetPluginDescriptor(name));
+		// modules without plugins are never loaded, they only fill the lookup tables
+		env.AddModule("module_" + std::to_string(i), "lang_" + std::to_string(i));
+	}
+
+	env.Start();
+	auto pluginManager = env.GetPluginManager();
+
+	// the middle entry, so a linear scan would pay for half of the list
+	auto name = "plugin_" + std::to_string(count / 2);
+	auto plugin = pluginManager->FindPlugin(name);
+	REQUIRE(plugin);
+	REQUIRE(pluginManager->FindPluginFromId(plugin.GetId()).GetName() == name);
+
+	auto moduleName = "module_" + std::to_string(count / 2);
+	auto moduleLang = "lang_" + std::to_string(count / 2);
+	auto module = pluginManager->FindModule(moduleName);
+	REQUIRE(module);
+	REQUIRE(pluginManager->FindModuleFromLang(moduleLang).GetId() == module.GetId());
+	REQUIRE(pluginManager->FindModuleFromId(module.GetId()).GetName() == moduleName);
+
+	auto suffix = " (" + std::to_string(count) + " plugins)";
+
+	BENCHMARK("FindPlugin by name" + suffix) {
+		return pluginManager->FindPlugin(name);
+	};
+
+	BENCHMARK("FindPlugin by id" + suffix) {
+		return pluginManager->FindPluginFromId(plugin.GetId());
+	};
+
+	BENCHMARK("FindModule by name" + suffix) {
+		return pluginManager->FindModule(moduleName);
+	};
+
+	BENCHMARK("FindModule by id" + suffix) {
+		return pluginManager->FindModuleFromId(module.GetId());
+	};
+
+	BENCHMARK("FindModule by lang" + suffix) {
+		return pluginManager->FindModuleFromLang(moduleLang);
+	};
+}
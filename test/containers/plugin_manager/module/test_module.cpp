@@ -0,0 +1,86 @@
+#include "../test_module.hpp"
+
+#include <plugify/language_module.hpp>
+#include <plugify/module.hpp>
+#include <plugify/plugin.hpp>
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#if defined(_WIN32)
+#define TEST_MODULE_EXPORT __declspec(dllexport)
+#else
+#define TEST_MODULE_EXPORT __attribute__((visibility("default")))
+#endif
+
+namespace {
+
+// Plugins only count their callbacks, data survives reloads so the test can compare generations
+class TestLanguageModule final : public plugify::ILanguageModule {
+public:
+	plugify::InitResult Initialize(std::weak_ptr<plugify::IPlugifyProvider>, plugify::ModuleHandle) override {
+		return plugify::InitResultData{};
+	}
+
+	void Shutdown() override {
+		std::lock_guard<std::mutex> lock(_mutex);
+		_plugins.clear();
+	}
+
+	void OnUpdate(plugify::DateTime) override {}
+
+	plugify::LoadResult OnPluginLoad(plugify::PluginHandle plugin) override {
+		auto& data = GetData(plugin);
+		++data.loads;
+
+		plugify::MethodTable table;
+		table.hasUpdate = true;
+		table.hasStart = true;
+		table.hasEnd = true;
+		return plugify::LoadResultData{ {}, &data, table };
+	}
+
+	void OnPluginStart(plugify::PluginHandle plugin) override {
+		++GetData(plugin).starts;
+	}
+
+	void OnPluginUpdate(plugify::PluginHandle plugin, plugify::DateTime) override {
+		++plugin.GetData().RCast<TestPluginData*>()->updates;
+	}
+
+	void OnPluginEnd(plugify::PluginHandle plugin) override {
+		++GetData(plugin).ends;
+	}
+
+	void OnMethodExport(plugify::PluginHandle) override {}
+
+	bool IsDebugBuild() override {
+#if defined(NDEBUG)
+		return false;
+#else
+		return true;
+#endif
+	}
+
+private:
+	TestPluginData& GetData(plugify::PluginHandle plugin) {
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto& data = _plugins[std::string(plugin.GetName())];
+		if (!data) {
+			data = std::make_unique<TestPluginData>();
+		}
+		return *data;
+	}
+
+	std::mutex _mutex;
+	std::map<std::string, std::unique_ptr<TestPluginData>> _plugins;
+};
+
+TestLanguageModule g_module;
+
+} // namespace
+
+extern "C" TEST_MODULE_EXPORT plugify::ILanguageModule* GetLanguageModule() {
+	return &g_module;
+}
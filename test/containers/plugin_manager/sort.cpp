@@ -0,0 +1,149 @@
+#include <catch_amalgamated.hpp>
+
+#include <plugify/plugin.hpp>
+
+#include "fixture.hpp"
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+class CaptureLogger final : public plugify::ILogger {
+public:
+	void Log(std::string_view msg, plugify::Severity severity) override {
+		if (severity != plugify::Severity::Warning)
+			return;
+		std::lock_guard lock(_mutex);
+		_warnings.emplace_back(msg);
+	}
+
+	std::vector<std::string> GetWarnings() const {
+		std::lock_guard lock(_mutex);
+		return _warnings;
+	}
+
+private:
+	mutable std::mutex _mutex;
+	std::vector<std::string> _warnings;
+};
+
+std::string GetName(size_t index) {
+	return "plugin_" + std::to_string(index);
+}
+
+// Every plugin depends on up to three earlier ones, so the graph is acyclic and the
+// generation order is already a valid load order the sort has to reproduce some other way
+std::vector<std::vector<std::string>> GetDependencyGraph(size_t count) {
+	std::vector<std::vector<std::string>> graph(count);
+	for (size_t i = 1; i < count; ++i) {
+		auto& dependencies = graph[i];
+		dependencies.push_back(GetName(i - 1));
+		if (i / 2 != i - 1) {
+			dependencies.push_back(GetName(i / 2));
+		}
+		if (i / 3 != i - 1 && i / 3 != i / 2) {
+			dependencies.push_back(GetName(i / 3));
+		}
+	}
+	return graph;
+}
+
+// Positions of the plugins in the order the plugin manager loads them
+std::unordered_map<std::string, size_t> GetLoadOrder(const plugify::IPluginManager& pluginManager) {
+	std::unordered_map<std::string, size_t> order;
+	auto plugins = pluginManager.GetPlugins();
+	for (size_t i = 0; i < plugins.size(); ++i) {
+		order.emplace(plugins[i].GetName(), i);
+	}
+	return order;
+}
+
+} // namespace
+
+TEST_CASE("plugin manager > sort by dependencies", "[plugin_manager]") {
+	SECTION("dependencies are loaded first") {
+		constexpr size_t kCount = 100;
+		auto graph = GetDependencyGraph(kCount);
+
+		PluginTestEnvironment env("plugify_sort_order");
+		// written in reverse, so the order found on disk is the worst one
+		for (size_t i = kCount; i-- > 0;) {
+			env.AddPlugin(GetName(i), GetPluginDescriptor(GetName(i), graph[i]));
+		}
+
+		env.Start();
+		auto order = GetLoadOrder(*env.GetPluginManager());
+		REQUIRE(order.size() == kCount);
+		for (size_t i = 0; i < kCount; ++i) {
+			for (const auto& dependency : graph[i]) {
+				INFO(GetName(i) << " depends on " << dependency);
+				REQUIRE(order.at(dependency) < order.at(GetName(i)));
+			}
+		}
+	}
+
+	SECTION("cycles are reported") {
+		auto logger = std::make_shared<CaptureLogger>();
+
+		PluginTestEnvironment env("plugify_sort_cycle");
+		env.AddPlugin("first", GetPluginDescriptor("First", { "second" }));
+		env.AddPlugin("second", GetPluginDescriptor("Second", { "third" }));
+		env.AddPlugin("third", GetPluginDescriptor("Third", { "first" }));
+		env.AddPlugin("self", GetPluginDescriptor("Self", { "self" }));
+		env.AddPlugin("dependent", GetPluginDescriptor("Dependent", { "first" }));
+		env.AddPlugin("free", GetPluginDescriptor("Free"));
+
+		env.Start(logger);
+
+		std::vector<std::string> cycles;
+		for (const auto& warning : logger->GetWarnings()) {
+			if (warning.find("Found cyclic dependencies") != std::string::npos) {
+				cycles.push_back(warning);
+			}
+		}
+		REQUIRE(cycles.size() == 2);
+
+		auto reported = [&](std::string_view name) {
+			for (const auto& cycle : cycles) {
+				if (cycle.find(name) != std::string::npos)
+					return true;
+			}
+			return false;
+		};
+		REQUIRE(reported("'first'"));
+		REQUIRE(reported("'second'"));
+		REQUIRE(reported("'third'"));
+		REQUIRE(reported("'self'"));
+		REQUIRE(!reported("'dependent'"));
+		REQUIRE(!reported("'free'"));
+
+		// plugins outside of a cycle still keep their order
+		auto order = GetLoadOrder(*env.GetPluginManager());
+		REQUIRE(order.size() == 6);
+		REQUIRE(order.at("first") < order.at("dependent"));
+	}
+}
+
+TEST_CASE("plugin manager > sort benchmark", "[plugin_manager][benchmark]") {
+	constexpr size_t kCount = 10000;
+	auto graph = GetDependencyGraph(kCount);
+
+	PluginTestEnvironment env("plugify_sort_benchmark");
+	for (size_t i = kCount; i-- > 0;) {
+		env.AddPlugin(GetName(i), GetPluginDescriptor(GetName(i), graph[i]));
+	}
+
+	env.Start();
+	auto pluginManager = env.GetPluginManager();
+	REQUIRE(pluginManager->GetPlugins().size() == kCount);
+
+	// The sort is private to the plugin manager and runs during discovery, so it is timed
+	// together with loading the plugins, the package scan is not repeated
+	BENCHMARK("Initialize with 10000 dependent plugins") {
+		pluginManager->Terminate();
+		return pluginManager->Initialize();
+	};
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Counters which the test language module hands out as plugin data
+struct TestPluginData {
+	std::atomic<uint32_t> loads{};
+	std::atomic<uint32_t> starts{};
+	std::atomic<uint32_t> ends{};
+	std::atomic<uint64_t> updates{};
+};
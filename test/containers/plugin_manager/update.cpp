@@ -0,0 +1,38 @@
+#include <catch_amalgamated.hpp>
+
+#include <plugify/date_time.hpp>
+#include <plugify/plugin.hpp>
+
+#include "fixture.hpp"
+#include "test_module.hpp"
+
+#include <chrono>
+#include <string>
+
+using namespace std::chrono_literals;
+
+TEST_CASE("plugin manager > update benchmark", "[plugin_manager][benchmark]") {
+	constexpr int kCount = 500;
+
+	PluginTestEnvironment env("plugify_update_benchmark");
+	for (int i = 0; i < kCount; ++i) {
+		auto name = "plugin_" + std::to_string(i);
+		env.AddPlugin(name, GetPluginDescriptor(name));
+	}
+
+	env.Start();
+	auto pluginManager = env.GetPluginManager();
+	auto plugins = pluginManager->GetPlugins();
+	REQUIRE(plugins.size() == kCount);
+
+	// every test plugin has an update callback which only bumps a counter
+	pluginManager->Update(plugify::DateTime(16ms));
+	for (const auto& plugin : plugins) {
+		REQUIRE(plugin.GetState() == plugify::PluginState::Running);
+		REQUIRE(plugin.GetData().RCast<TestPluginData*>()->updates == 1);
+	}
+
+	BENCHMARK("Update with 500 plugins") {
+		pluginManager->Update(plugify::DateTime(16ms));
+	};
+}
@@ -182,7 +182,7 @@ int main() {
 						CONPRINT("Plugin Manager commands:");
 						CONPRINT("  load           - Load plugin manager");
 						CONPRINT("  unload         - Unload plugin manager");
-						CONPRINT("  reload         - Reload plugin manager");
+						CONPRINT("  reload [name]  - Reload plugin manager or single plugin");
 						CONPRINT("  modules        - List running modules");
 						CONPRINT("  plugins        - List running plugins");
 						CONPRINT("  plugin <name>  - Show information about a module");
@@ -251,7 +251,20 @@ int main() {
 					}
 
 					else if (args[1] == "reload") {
-						if (!pluginManager->IsInitialized()) {
+						if (args.size() > 2) {
+							if (!pluginManager->IsInitialized()) {
+								CONPRINTE("Plugin manager not loaded.");
+								continue;
+							}
+							auto start = std::chrono::steady_clock::now();
+							bool reloaded = pluginManager->ReloadPlugin(args[2]);
+							auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+							if (reloaded) {
+								CONPRINTF("Plugin {} was reloaded in {:.3f}ms.", args[2], elapsed);
+							} else {
+								CONPRINTF("Plugin {} failed to reload in {:.3f}ms.", args[2], elapsed);
+							}
+						} else if (!pluginManager->IsInitialized()) {
 							CONPRINTE("Plugin manager not loaded.");
 							packageManager->Reload();
 						} else {